@@ -0,0 +1,21 @@
+# turns a file into a header with a constexpr byte array in it
+# cmake -DINPUT=<file> -DOUTPUT=<header> -DNAME=<array name> -P EmbedFile.cmake
+
+file(READ ${INPUT} HEX HEX)
+string(LENGTH "${HEX}" SIZE)
+math(EXPR SIZE "${SIZE} / 2")
+
+# 16 bytes per line
+set(LINE "")
+foreach(i RANGE 1 16)
+    string(APPEND LINE "0x[0-9a-f][0-9a-f],")
+endforeach()
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+string(REGEX REPLACE "(${LINE})" "\\1\n    " BYTES "${BYTES}")
+
+get_filename_component(INPUT_NAME ${INPUT} NAME)
+file(WRITE ${OUTPUT}.tmp "// generated from ${INPUT_NAME}, don't edit\n\n#pragma once\n\n#include <cstdint>\n\nstatic constexpr uint8_t ${NAME}[${SIZE}] = {\n    ${BYTES}\n};")
+
+# only touch it if it changed, everything including it would rebuild otherwise
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
\ No newline at end of file
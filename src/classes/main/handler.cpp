@@ -79,6 +79,10 @@ void Handler::closeTab(int id) {
         }
     }
 }
+void Handler::reloadTab(int id) {
+    int index = getTab(id);
+    if (index != -1) tabs[index]->reload();
+}
 int Handler::getTab(int id) {
     for (int i = 0; i < tabs.size(); i++) {
         if (tabs[i]->getId() == id) {
@@ -14,6 +14,7 @@ class Handler {
 
         void focusTab(int id);
         void closeTab(int id);
+        void reloadTab(int id);
         int getTab(int id);
 
         void drawInput(Vector2i pos, Vector2i size);
@@ -0,0 +1,77 @@
+#include "hotcache.h"
+
+HotCache::HotCache() {
+    // do nothing
+}
+
+void HotCache::setBudget(size_t m_budget) {
+    budget = m_budget;
+    evict();
+}
+
+const HotCacheEntry* HotCache::lookup(const std::string& key) {
+    auto found = entries.find(key);
+    if (found == entries.end()) {
+        misses++;
+        return NULL;
+    }
+    hits++;
+
+    // to the front, nothing gets copied
+    order.splice(order.begin(), order, found->second);
+    return &found->second->second;
+}
+void HotCache::store(const std::string& key, HttpBuffer body, const HttpHeaders& headers) {
+    remove(key);
+
+    HotCacheEntry entry = {body, headers};
+    size_t size = entryBytes(entry);
+    if (body == nullptr || size > budget) return;
+
+    order.emplace_front(key, entry);
+    entries[key] = order.begin();
+    bytes += size;
+
+    evict();
+}
+void HotCache::updateHeaders(const std::string& key, const HttpHeaders& headers) {
+    auto found = entries.find(key);
+    if (found == entries.end()) return;
+
+    HotCacheEntry* entry = &found->second->second;
+    bytes -= entryBytes(*entry);
+    entry->headers = headers;
+    bytes += entryBytes(*entry);
+
+    evict();
+}
+void HotCache::remove(const std::string& key) {
+    auto found = entries.find(key);
+    if (found == entries.end()) return;
+
+    bytes -= entryBytes(found->second->second);
+    order.erase(found->second);
+    entries.erase(found);
+}
+
+uint64_t HotCache::getHits() {
+    return hits;
+}
+uint64_t HotCache::getMisses() {
+    return misses;
+}
+size_t HotCache::getBytes() {
+    return bytes;
+}
+
+void HotCache::evict() {
+    while (bytes > budget && order.empty() == false) {
+        remove(order.back().first);
+    }
+}
+// the body is what matters, headers are counted so lots of tiny responses still add up
+size_t HotCache::entryBytes(const HotCacheEntry& entry) {
+    size_t size = entry.body != nullptr ? entry.body->size() : 0;
+    for (const auto& header : entry.headers) size += header.first.size() + header.second.size();
+    return size;
+}
\ No newline at end of file
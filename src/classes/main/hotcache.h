@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// response headers, names in lowercase, in the order they came in
+typedef std::vector<std::pair<std::string, std::string>> HttpHeaders;
+
+// a response body nobody changes after it came in, shared by the caches and everyone reading it
+typedef std::shared_ptr<const std::string> HttpBuffer;
+
+#define HOTCACHE_BUDGET (16 * 1024 * 1024)
+
+typedef struct {
+    HttpBuffer body;
+    HttpHeaders headers;
+} HotCacheEntry;
+
+// recently used responses kept in memory, in front of the disk cache. knows nothing about HTTP,
+// HttpCache decides what goes in and whether it's still fresh
+class HotCache {
+    public:
+        HotCache();
+
+        void setBudget(size_t m_budget);
+
+        // NULL on a miss. the pointer is good until the next store/remove
+        const HotCacheEntry* lookup(const std::string& key);
+        void store(const std::string& key, HttpBuffer body, const HttpHeaders& headers);
+        // swaps the headers of what's there, if anything. not a use, so it's not counted and doesn't move it
+        void updateHeaders(const std::string& key, const HttpHeaders& headers);
+        void remove(const std::string& key);
+
+        uint64_t getHits();
+        uint64_t getMisses();
+        size_t getBytes();
+
+    private:
+        typedef std::list<std::pair<std::string, HotCacheEntry>> Order;
+
+        void evict();
+        static size_t entryBytes(const HotCacheEntry& entry);
+
+        Order order; // most recently used first
+        std::unordered_map<std::string, Order::iterator> entries;
+
+        size_t budget = HOTCACHE_BUDGET;
+        size_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+};
\ No newline at end of file
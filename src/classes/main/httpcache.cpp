@@ -0,0 +1,461 @@
+#include "httpcache.h"
+#include "networker.h"
+
+#include "../../libs/json.hpp"
+#include "../../logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+
+#include <curl/curl.h>
+
+#define HTTPCACHE_INDEX "index.json"
+#define HTTPCACHE_JOURNAL "journal.log"
+#define HTTPCACHE_JOURNAL_MAX 512 // lines before it gets folded into the index
+#define HTTPCACHE_VERSION 3
+#define HTTPCACHE_HEURISTIC_MAX 86400 // a day
+
+static std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return text;
+}
+static std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+// comma separated header values ("max-age=60, no-cache"), split and trimmed
+static std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos) end = value.size();
+
+        std::string item = trim(value.substr(start, end - start));
+        if (item.empty() == false) items.push_back(item);
+        start = end + 1;
+    }
+    return items;
+}
+
+// all of them joined, the way a list header can be split across lines
+static std::string findHeader(const HttpHeaders& headers, const char* name) {
+    std::string value;
+    for (const auto& header : headers) {
+        if (header.first != name) continue;
+        if (value.empty() == false) value += ", ";
+        value += header.second;
+    }
+    return value;
+}
+static bool hasHeader(const HttpHeaders& headers, const char* name) {
+    for (const auto& header : headers) {
+        if (header.first == name) return true;
+    }
+    return false;
+}
+
+// one entry in the index, and in the journal
+static nlohmann::json entryToJson(const HttpCacheEntry& entry) {
+    nlohmann::json item;
+    item["url"] = entry.url;
+    item["file"] = entry.file;
+    item["size"] = entry.size;
+    item["status"] = entry.status;
+    item["response_time"] = entry.responseTime;
+    item["age_base"] = entry.ageBase;
+    item["lifetime"] = entry.lifetime;
+    if (entry.etag.empty() == false) item["etag"] = entry.etag;
+    if (entry.lastModified.empty() == false) item["last_modified"] = entry.lastModified;
+    if (entry.vary.empty() == false) item["vary"] = entry.vary;
+    if (entry.headers.empty() == false) item["headers"] = entry.headers;
+    return item;
+}
+static bool entryFromJson(const nlohmann::json& item, HttpCacheEntry* entry) {
+    if (item.is_object() == false) return false;
+
+    *entry = {};
+    entry->url = item.value("url", "");
+    entry->file = item.value("file", "");
+    entry->size = item.value("size", (size_t)0);
+    entry->status = item.value("status", 0L);
+    entry->responseTime = item.value("response_time", (time_t)0);
+    entry->ageBase = item.value("age_base", 0L);
+    entry->lifetime = item.value("lifetime", 0L);
+    entry->etag = item.value("etag", "");
+    entry->lastModified = item.value("last_modified", "");
+    if (item.contains("vary")) entry->vary = item["vary"].get<std::map<std::string, std::string>>();
+    if (item.contains("headers")) entry->headers = item["headers"].get<HttpHeaders>();
+
+    return entry->url.empty() == false && entry->file.empty() == false;
+}
+
+HttpCache::HttpCache() {
+    // do nothing
+}
+
+void HttpCache::init(std::string m_directory, size_t m_budget, size_t hotBudget) {
+    directory = m_directory;
+    budget = m_budget;
+    hot.setBudget(hotBudget);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        Logger_log(LOGGER_WARNING, "CACHE: Couldn't create %s, running without a disk cache", directory.c_str());
+        return;
+    }
+
+    load();
+    replay();
+    save(); // starts a fresh journal
+    ready = true;
+    Logger_log(LOGGER_INFO, "CACHE: %d responses (%zu KB) in %s", (int)entries.size(), bytes / 1024, directory.c_str());
+}
+void HttpCache::close() {
+    if (ready == false) return;
+
+    // the journal only has stores and removes, what got used since is only known here
+    save();
+    journal.close();
+    ready = false;
+
+    Logger_log(LOGGER_INFO, "CACHE: Memory hits %llu, misses %llu (%zu KB held)",
+        (unsigned long long)hot.getHits(), (unsigned long long)hot.getMisses(), hot.getBytes() / 1024);
+}
+
+// lookups
+const HttpCacheEntry* HttpCache::lookup(const std::string& url) {
+    if (ready == false) return NULL;
+
+    auto found = entries.find(url);
+    if (found == entries.end()) return NULL;
+    HttpCacheEntry* entry = &found->second->second;
+
+    // only good for requests that would've gotten the same response
+    for (const auto& header : entry->vary) {
+        if (requestHeader(header.first) != header.second) return NULL;
+    }
+
+    touch(found->second);
+    return entry;
+}
+bool HttpCache::isFresh(const HttpCacheEntry* entry) {
+    long age = entry->ageBase + (long)std::max((time_t)0, time(NULL) - entry->responseTime);
+    return entry->lifetime > age;
+}
+bool HttpCache::readBody(const HttpCacheEntry* entry, HttpBuffer* body) {
+    const HotCacheEntry* cached = hot.lookup(entry->url);
+    if (cached != NULL) {
+        *body = cached->body;
+        return true;
+    }
+
+    std::ifstream file(directory + "/" + entry->file, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    std::string data(entry->size, '\0');
+    file.read(&data[0], entry->size);
+    if ((size_t)file.gcount() != entry->size) return false;
+
+    // next time it comes out of memory
+    *body = std::make_shared<const std::string>(std::move(data));
+    hot.store(entry->url, *body, entry->headers);
+    return true;
+}
+
+// updates
+void HttpCache::store(const std::string& url, long status, const HttpHeaders& headers, HttpBuffer body) {
+    if (ready == false || body == nullptr) return;
+
+    // whatever was there is outdated now, stored or not
+    remove(url);
+
+    // only what's cacheable by default, anything else would need explicit freshness we don't bother with
+    if (status != 200 && status != 203 && status != 300 && status != 301 && status != 404 && status != 410) return;
+    if (body->size() > budget) return;
+
+    std::string cacheControl = lowercase(findHeader(headers, "cache-control"));
+    for (const std::string& directive : splitList(cacheControl)) {
+        if (directive == "no-store") return;
+    }
+
+    HttpCacheEntry entry = {};
+    entry.url = url;
+    entry.status = status;
+    applyHeaders(&entry, headers);
+
+    // Vary: * never matches anything
+    for (const std::string& name : splitList(lowercase(findHeader(headers, "vary")))) {
+        if (name == "*") return;
+        entry.vary[name] = requestHeader(name);
+    }
+
+    // can't be used without going to the network, and can't be revalidated either
+    if (entry.lifetime <= 0 && entry.etag.empty() && entry.lastModified.empty()) return;
+
+    entry.file = std::to_string(nextFile++) + ".body";
+    entry.size = body->size();
+    entry.headers = headers;
+
+    // written next to it first, so a crash never leaves half a body behind
+    std::string path = directory + "/" + entry.file;
+    {
+        std::ofstream file(path + ".tmp", std::ios::binary);
+        if (!file.is_open()) return;
+        file.write(body->data(), body->size());
+        if (!file.good()) return;
+    }
+    std::error_code error;
+    std::filesystem::rename(path + ".tmp", path, error);
+    if (error) return;
+
+    order.emplace_front(url, entry);
+    entries[url] = order.begin();
+    bytes += entry.size;
+    hot.store(url, body, headers);
+    journalStore(entry);
+
+    evict();
+}
+void HttpCache::refresh(const std::string& url, const HttpHeaders& headers) {
+    auto found = entries.find(url);
+    if (found == entries.end()) return;
+
+    // a 304 carries the new freshness, and maybe new validators
+    HttpCacheEntry* entry = &found->second->second;
+    applyHeaders(entry, headers);
+    touch(found->second);
+
+    // and whatever headers it has replace the stored ones, the body related ones stay
+    for (const auto& header : headers) {
+        if (header.first == "content-length" || header.first == "content-encoding" || header.first == "transfer-encoding") continue;
+        entry->headers.erase(std::remove_if(entry->headers.begin(), entry->headers.end(), [&header](const std::pair<std::string, std::string>& old) { return old.first == header.first; }), entry->headers.end());
+    }
+    for (const auto& header : headers) {
+        if (header.first == "content-length" || header.first == "content-encoding" || header.first == "transfer-encoding") continue;
+        entry->headers.push_back(header);
+    }
+
+    hot.updateHeaders(url, entry->headers);
+
+    journalStore(*entry);
+}
+void HttpCache::remove(const std::string& url) {
+    auto found = entries.find(url);
+    if (found == entries.end()) return;
+
+    std::error_code error;
+    std::filesystem::remove(directory + "/" + found->second->second.file, error);
+
+    // url might be the key that's about to go
+    std::string key = url;
+    bytes -= found->second->second.size;
+    order.erase(found->second);
+    entries.erase(found);
+    hot.remove(key);
+    journalRemove(key);
+}
+
+std::string HttpCache::requestHeader(const std::string& name) {
+    // everything we send is the same for every request, see Networker::SetInstanceDef
+    if (name == "user-agent") return NETWORK_USER_AGENT;
+    if (name == "accept") return "*/*";
+    return "";
+}
+
+std::string HttpCache::normalize(const std::string& url) {
+    std::string result = url.substr(0, url.find('#'));
+
+    size_t scheme = result.find("://");
+    if (scheme == std::string::npos) return result;
+
+    size_t hostStart = scheme + 3;
+    size_t hostEnd = result.find_first_of("/?", hostStart);
+    if (hostEnd == std::string::npos) hostEnd = result.size();
+
+    std::string schemeName = lowercase(result.substr(0, scheme));
+    std::string host = lowercase(result.substr(hostStart, hostEnd - hostStart));
+    std::string rest = result.substr(hostEnd);
+
+    // the port it'd use anyway
+    if (schemeName == "http" && host.size() > 3 && host.compare(host.size() - 3, 3, ":80") == 0) host.resize(host.size() - 3);
+    if (schemeName == "https" && host.size() > 4 && host.compare(host.size() - 4, 4, ":443") == 0) host.resize(host.size() - 4);
+
+    if (rest.empty() || rest[0] == '?') rest = "/" + rest;
+    return schemeName + "://" + host + rest;
+}
+
+HotCache* HttpCache::getHotCache() {
+    return &hot;
+}
+
+// works out freshness from a response's headers, RFC 9111 style
+void HttpCache::applyHeaders(HttpCacheEntry* entry, const HttpHeaders& headers) {
+    time_t now = time(NULL);
+
+    time_t date = now;
+    if (hasHeader(headers, "date")) {
+        time_t parsed = curl_getdate(findHeader(headers, "date").c_str(), NULL);
+        if (parsed > 0) date = parsed;
+    }
+
+    long age = 0;
+    if (hasHeader(headers, "age")) age = std::max(std::atol(findHeader(headers, "age").c_str()), 0L);
+
+    entry->responseTime = now;
+    entry->ageBase = std::max((long)std::max((time_t)0, now - date), age);
+
+    if (hasHeader(headers, "etag")) entry->etag = findHeader(headers, "etag");
+    if (hasHeader(headers, "last-modified")) entry->lastModified = findHeader(headers, "last-modified");
+
+    bool noCache = false;
+    long maxAge = -1;
+    std::string cacheControl = lowercase(findHeader(headers, "cache-control"));
+    for (const std::string& directive : splitList(cacheControl)) {
+        if (directive == "no-cache") noCache = true;
+        else if (directive.rfind("max-age=", 0) == 0) maxAge = std::max(std::atol(directive.c_str() + 8), 0L);
+    }
+    if (cacheControl.empty() && lowercase(findHeader(headers, "pragma")).find("no-cache") != std::string::npos) noCache = true;
+
+    if (noCache == true) {
+        entry->lifetime = 0;
+    } else if (maxAge >= 0) {
+        entry->lifetime = maxAge;
+    } else if (hasHeader(headers, "expires")) {
+        // a broken Expires means it's already expired
+        time_t expires = curl_getdate(findHeader(headers, "expires").c_str(), NULL);
+        entry->lifetime = expires > 0 ? (long)std::max((time_t)0, expires - date) : 0;
+    } else if (entry->lastModified.empty() == false) {
+        // nothing explicit, a tenth of how long it went unchanged
+        time_t modified = curl_getdate(entry->lastModified.c_str(), NULL);
+        entry->lifetime = modified > 0 ? std::min((long)std::max((time_t)0, date - modified) / 10, (long)HTTPCACHE_HEURISTIC_MAX) : 0;
+    } else {
+        entry->lifetime = 0;
+    }
+}
+
+// least recently used first, off the back
+void HttpCache::evict() {
+    while (bytes > budget && order.empty() == false) {
+        std::string url = order.back().first;
+        remove(url);
+    }
+}
+void HttpCache::touch(Order::iterator position) {
+    order.splice(order.begin(), order, position);
+}
+
+// the index
+void HttpCache::load() {
+    order.clear();
+    entries.clear();
+    bytes = 0;
+
+    std::ifstream file(directory + "/" + HTTPCACHE_INDEX);
+    if (!file.is_open()) return;
+
+    nlohmann::json json = nlohmann::json::parse(file, nullptr, false);
+    if (json.is_discarded() || json.value("version", 0) != HTTPCACHE_VERSION) {
+        Logger_log(LOGGER_WARNING, "CACHE: Index in %s is unreadable, starting over", directory.c_str());
+        return;
+    }
+
+    // saved most recently used first, so that's the order they go back in
+    nextFile = json.value("next_file", (uint64_t)1);
+    for (const nlohmann::json& item : json["entries"]) {
+        HttpCacheEntry entry;
+        if (entryFromJson(item, &entry) == false || entries.count(entry.url) > 0) continue;
+
+        order.emplace_back(entry.url, entry);
+        entries[entry.url] = std::prev(order.end());
+        bytes += entry.size;
+    }
+}
+// everything that changed after the index was last written. stops at the first line that doesn't parse,
+// that's where it was when it got cut off
+void HttpCache::replay() {
+    std::ifstream file(directory + "/" + HTTPCACHE_JOURNAL);
+    if (!file.is_open()) return;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        nlohmann::json record = nlohmann::json::parse(line, nullptr, false);
+        if (record.is_discarded() || record.is_object() == false) break;
+
+        std::string url;
+        HttpCacheEntry entry;
+        bool stored = record.contains("store") && entryFromJson(record["store"], &entry);
+        if (stored == true) url = entry.url;
+        else if (record.contains("remove") && record["remove"].is_string()) url = record["remove"].get<std::string>();
+        else break;
+
+        // the file is already gone, or it's the one that replaces it
+        auto found = entries.find(url);
+        if (found != entries.end()) {
+            bytes -= found->second->second.size;
+            order.erase(found->second);
+            entries.erase(found);
+        }
+
+        if (stored == true) {
+            order.emplace_front(url, entry);
+            entries[url] = order.begin();
+            bytes += entry.size;
+            nextFile = std::max(nextFile, (uint64_t)std::strtoull(entry.file.c_str(), NULL, 10) + 1);
+        }
+    }
+}
+// writes the whole index, and starts the journal over
+void HttpCache::save() {
+    nlohmann::json json;
+    json["version"] = HTTPCACHE_VERSION;
+    json["next_file"] = nextFile;
+    json["entries"] = nlohmann::json::array();
+    for (const auto& pair : order) json["entries"].push_back(entryToJson(pair.second));
+
+    std::string path = directory + "/" + HTTPCACHE_INDEX;
+    {
+        std::ofstream file(path + ".tmp");
+        if (!file.is_open()) {
+            Logger_log(LOGGER_WARNING, "CACHE: Couldn't write the index to %s", directory.c_str());
+            return;
+        }
+        file << json.dump();
+    }
+
+    std::error_code error;
+    std::filesystem::rename(path + ".tmp", path, error);
+    if (error) return;
+
+    // only once the index has all of it. replaying it again on top would be harmless anyway
+    journal.close();
+    journal.open(directory + "/" + HTTPCACHE_JOURNAL, std::ios::trunc);
+    journalLines = 0;
+}
+// one line per change instead of the whole index every time
+void HttpCache::journalStore(const HttpCacheEntry& entry) {
+    if (journal.is_open() == false) return;
+
+    nlohmann::json record;
+    record["store"] = entryToJson(entry);
+    journal << record.dump() << "\n";
+    journal.flush();
+
+    if (++journalLines >= HTTPCACHE_JOURNAL_MAX) save();
+}
+void HttpCache::journalRemove(const std::string& url) {
+    if (journal.is_open() == false) return;
+
+    nlohmann::json record;
+    record["remove"] = url;
+    journal << record.dump() << "\n";
+    journal.flush();
+
+    if (++journalLines >= HTTPCACHE_JOURNAL_MAX) save();
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "hotcache.h"
+
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+// the size everything that's on disk gets kept under, least recently used goes first
+#define HTTPCACHE_BUDGET (64 * 1024 * 1024)
+
+typedef struct {
+    std::string url;
+    std::string file; // in the cache directory
+    size_t size;
+    long status;
+
+    // freshness, all in seconds
+    time_t responseTime; // when it came in or was last revalidated
+    long ageBase;        // how old it already was at responseTime
+    long lifetime;       // fresh until it's this old, 0 means it has to be revalidated every time
+
+    // validators
+    std::string etag;
+    std::string lastModified;
+
+    std::map<std::string, std::string> vary; // request header -> what we sent for it
+    HttpHeaders headers;
+} HttpCacheEntry;
+
+// a private HTTP cache on disk: a json index, plus one file per body.
+// changes get appended to a journal next to the index, which gets folded back into it on load, on close, and once it's long.
+// follows Cache-Control (max-age, no-cache, no-store), Expires, Vary, and revalidates with ETag/Last-Modified.
+// recently used bodies also stay in memory (HotCache), so those never touch the disk.
+// everything is keyed by normalize(url)
+class HttpCache {
+    public:
+        HttpCache();
+
+        void init(std::string m_directory, size_t m_budget, size_t hotBudget);
+        void close();
+
+        // NULL if nothing usable is stored for it
+        const HttpCacheEntry* lookup(const std::string& url);
+        bool isFresh(const HttpCacheEntry* entry);
+        bool readBody(const HttpCacheEntry* entry, HttpBuffer* body); // shares the buffer if it's in memory
+
+        // after a full response. stores it if the headers allow it, the old one goes either way
+        void store(const std::string& url, long status, const HttpHeaders& headers, HttpBuffer body);
+        // after a 304, what's stored is good again
+        void refresh(const std::string& url, const HttpHeaders& headers);
+        void remove(const std::string& url);
+
+        // what we send for a request header, for matching Vary
+        static std::string requestHeader(const std::string& name);
+        // lowercase scheme and host, no default port, no fragment, at least a /
+        static std::string normalize(const std::string& url);
+
+        HotCache* getHotCache();
+
+    private:
+        typedef std::list<std::pair<std::string, HttpCacheEntry>> Order;
+
+        void applyHeaders(HttpCacheEntry* entry, const HttpHeaders& headers);
+        void evict();
+        void touch(Order::iterator position);
+
+        void load();
+        void replay();
+        void save();
+        void journalStore(const HttpCacheEntry& entry);
+        void journalRemove(const std::string& url);
+
+        bool ready = false;
+        std::string directory;
+        size_t budget = HTTPCACHE_BUDGET;
+        size_t bytes = 0;
+        uint64_t nextFile = 1;
+
+        Order order; // most recently used first, and the order the index gets saved in
+        std::unordered_map<std::string, Order::iterator> entries; // by url
+        HotCache hot;
+
+        std::ofstream journal;
+        int journalLines = 0;
+};
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "networker.h"
+#include "request.h"
+#include "../../main.h"
+
 #include <string>
 
 Networker::Networker() {
@@ -57,12 +60,165 @@ void Networker::init() {
         ready = true;
     }
 
+    multi = curl_multi_init();
+    if (multi == NULL) {
+        Logger_log(LOGGER_ERROR, "NETWORK: Couldn't create the curl multi handle");
+        ready = false;
+    }
+
+    cache.init(NETWORK_CACHE_DIRECTORY, HTTPCACHE_BUDGET, HOTCACHE_BUDGET);
+
+    // a second visit to a host skips the lookup, the TCP handshake and the TLS handshake
+    share = curl_share_init();
+    if (share != NULL) {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, onShareLock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, onShareUnlock);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    } else {
+        Logger_log(LOGGER_WARNING, "NETWORK: Couldn't create the curl share handle, nothing gets reused between requests");
+    }
+
     Logger_log(LOGGER_INFO, "----------------------------------------------------------------------------------");
 }
 void Networker::update() {
-    
+    if (multi == NULL) return;
+
+    #ifndef _WIN32
+    if (reactor != NULL) return;
+    #endif
+
+    // never waits, just moves whatever can be moved right now
+    if (transfers.empty() == true) return;
+    curl_multi_perform(multi, &running);
+    finishTransfers();
+}
+void Networker::close() {
+    cache.close();
+    if (multi == NULL) return;
+
+    // whatever's still going just gets dropped, nobody's around for the callbacks anymore
+    for (CURL* curl : transfers) curl_multi_remove_handle(multi, curl);
+    transfers.clear();
+
+    curl_multi_cleanup(multi);
+    multi = NULL;
+
+    // requests that are still around keep using it, it just leaks then
+    if (share != NULL && curl_share_cleanup(share) == CURLSHE_OK) share = NULL;
+}
+
+// the share handle has no locking of its own
+void Networker::onShareLock(CURL*, curl_lock_data data, curl_lock_access, void* userp) {
+    ((Networker*)userp)->shareLocks[data].lock();
+}
+void Networker::onShareUnlock(CURL*, curl_lock_data data, void* userp) {
+    ((Networker*)userp)->shareLocks[data].unlock();
 }
 
+// transfers
+bool Networker::start(Request* request, CURL* curl) {
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, request);
+
+    CURLMcode code = curl_multi_add_handle(multi, curl);
+    if (code != CURLM_OK) {
+        Logger_log(LOGGER_ERROR, "NETWORK: Couldn't start a transfer: %s", curl_multi_strerror(code));
+        return false;
+    }
+    transfers.insert(curl);
+    return true;
+}
+void Networker::cancel(CURL* curl) {
+    if (transfers.erase(curl) == 0) return;
+    curl_multi_remove_handle(multi, curl);
+}
+
+// hands finished transfers back to their requests
+void Networker::finishTransfers() {
+    bool finished = false;
+
+    CURLMsg* message;
+    int left;
+    while ((message = curl_multi_info_read(multi, &left)) != NULL) {
+        if (message->msg != CURLMSG_DONE) continue;
+
+        // the message is gone once the handle is removed
+        CURL* curl = message->easy_handle;
+        CURLcode result = message->data.result;
+
+        Request* request = NULL;
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**)&request);
+        curl_multi_remove_handle(multi, curl);
+        transfers.erase(curl);
+
+        if (request != NULL) request->finish(result);
+        finished = true;
+    }
+
+    // something probably changed on screen
+    if (finished == true) renderer->invalidate();
+}
+
+#ifndef _WIN32
+void Networker::attach(Reactor* m_reactor) {
+    reactor = m_reactor;
+
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, onSocket);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, onTimer);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+
+    // anything started before this only had update() looking after it
+    curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    finishTransfers();
+}
+
+// curl telling us which sockets it wants to hear about
+int Networker::onSocket(CURL*, curl_socket_t socket, int what, void* userp, void*) {
+    Networker* self = (Networker*)userp;
+
+    if (what == CURL_POLL_REMOVE) {
+        self->reactor->unwatch(socket);
+        return 0;
+    }
+
+    uint32_t events = 0;
+    if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) events |= EPOLLIN;
+    if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) events |= EPOLLOUT;
+
+    self->reactor->watch(socket, events, [self, socket](uint32_t ready) {
+        int flags = 0;
+        if (ready & EPOLLIN) flags |= CURL_CSELECT_IN;
+        if (ready & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+        if (ready & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+
+        curl_multi_socket_action(self->multi, socket, flags, &self->running);
+        self->finishTransfers();
+    });
+    return 0;
+}
+// and when it wants to be called even if none of them are ready
+int Networker::onTimer(CURLM*, long timeoutMs, void* userp) {
+    Networker* self = (Networker*)userp;
+
+    if (self->timerId != 0) self->reactor->cancelTimer(self->timerId);
+    self->timerId = 0;
+
+    // -1 means it doesn't need one anymore
+    if (timeoutMs >= 0) {
+        self->timerId = self->reactor->addTimer(timeoutMs / 1000.0, [self]() {
+            self->timerId = 0;
+            curl_multi_socket_action(self->multi, CURL_SOCKET_TIMEOUT, 0, &self->running);
+            self->finishTransfers();
+        });
+    }
+    return 0;
+}
+#endif
+
 void Networker::CheckCode(CURLcode code) {
     if (code != CURLE_OK) {
         Logger_logE("NETWORK: libcurl error: %s", curl_easy_strerror(code));
@@ -81,7 +237,18 @@ bool Networker::IsReady() {
 
 // Set default properties for a curl instance
 void Networker::SetInstanceDef(CURL* curl) {
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "webkitten/1.0");
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, NETWORK_USER_AGENT);
+
+    // no signals for DNS timeouts, they'd go off on whatever thread
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    if (share != NULL) curl_easy_setopt(curl, CURLOPT_SHARE, share);
+
+    // keepalive probes, so a dead peer on a long transfer gets noticed. this doesn't keep anything around for reuse
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    // reuse is up to the connection cache, let idle connections in it be picked up for longer than the 118s default
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, 300L);
 
     SetInstanceCert(curl);
 }
@@ -1,8 +1,23 @@
 #pragma once
 
+#include <mutex>
+#include <set>
+
 #include <curl/curl.h>
+#include "httpcache.h"
 #include "../../logger.h"
 
+#define NETWORK_USER_AGENT "webkitten/1.0"
+#define NETWORK_CACHE_DIRECTORY "cache"
+
+class Request;
+#ifndef _WIN32
+class Reactor;
+#endif
+
+// every transfer goes through one curl multi handle, nothing blocks the UI thread.
+// on Linux the reactor wakes the loop up when curl's sockets or timers need attention,
+// everywhere else update() drives it once per frame
 class Networker {
     public:
         Networker();
@@ -10,6 +25,16 @@ class Networker {
         void init();
         void update();
         void draw();
+        void close();
+
+        #ifndef _WIN32
+        void attach(Reactor* reactor); // from here on curl gets driven by the reactor instead of update()
+        #endif
+
+        // the request gets its finish() called from update() or the reactor, on the UI thread either way
+        // false if curl wouldn't take it, then nothing will call finish() for it
+        bool start(Request* request, CURL* curl);
+        void cancel(CURL* curl);
 
         void CheckCode(CURLcode code);
         bool IsReady();
@@ -17,6 +42,28 @@ class Networker {
         void SetInstanceDef(CURL* curl);
         void SetInstanceCert(CURL *curl);
 
+        HttpCache cache;
+
     private:
+        void finishTransfers();
+
+        static void onShareLock(CURL* curl, curl_lock_data data, curl_lock_access access, void* userp);
+        static void onShareUnlock(CURL* curl, curl_lock_data data, void* userp);
+
+        #ifndef _WIN32
+        static int onSocket(CURL* curl, curl_socket_t socket, int what, void* userp, void* socketp);
+        static int onTimer(CURLM* multi, long timeoutMs, void* userp);
+
+        Reactor* reactor = NULL;
+        int timerId = 0;
+        #endif
+
         bool ready;
+        CURLM* multi = NULL;
+        int running = 0;
+        std::set<CURL*> transfers; // added to multi and not finished yet
+
+        // DNS, connections and TLS sessions, shared by every handle no matter which thread it's on
+        CURLSH* share = NULL;
+        std::mutex shareLocks[CURL_LOCK_DATA_LAST];
 };
\ No newline at end of file
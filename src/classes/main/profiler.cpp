@@ -0,0 +1,95 @@
+#include "profiler.h"
+
+#include "../../internal/gsgl/gsgl.h"
+#include "../../libs/json.hpp"
+#include "../../logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+Profiler::Profiler() {
+    for (int i = 0; i < PROFILE_PHASES; i++) {
+        phases[i] = {};
+    }
+}
+
+void Profiler::begin(ProfilerPhase phase) {
+    phases[phase].started = gsgl_GetTime();
+}
+void Profiler::end(ProfilerPhase phase) {
+    Phase* p = &phases[phase];
+    double ms = (gsgl_GetTime() - p->started) * 1000.0;
+
+    int bucket = std::min((int)(ms / PROFILER_BUCKET_MS), PROFILER_BUCKETS - 1);
+    p->buckets[bucket]++;
+    p->count++;
+    p->total += ms;
+    p->max = std::max(p->max, ms);
+}
+
+double Profiler::percentile(ProfilerPhase phase, double percent) {
+    Phase* p = &phases[phase];
+    if (p->count == 0) return 0.0;
+
+    // the upper edge of the bucket it lands in, so it never reads better than it was
+    uint64_t target = (uint64_t)((percent / 100.0) * (double)p->count);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < PROFILER_BUCKETS; i++) {
+        seen += p->buckets[i];
+        if (seen >= target) return std::min((i + 1) * PROFILER_BUCKET_MS, p->max);
+    }
+    return p->max;
+}
+
+bool Profiler::dump(std::string path) {
+    nlohmann::json json;
+    json["bucket_ms"] = PROFILER_BUCKET_MS;
+
+    for (int i = 0; i < PROFILE_PHASES; i++) {
+        ProfilerPhase phase = (ProfilerPhase)i;
+        Phase* p = &phases[i];
+
+        nlohmann::json entry;
+        entry["count"] = p->count;
+        entry["mean_ms"] = p->count > 0 ? p->total / (double)p->count : 0.0;
+        entry["p50_ms"] = percentile(phase, 50);
+        entry["p95_ms"] = percentile(phase, 95);
+        entry["p99_ms"] = percentile(phase, 99);
+        entry["max_ms"] = p->max;
+
+        // only the buckets that have something in them, [ms, count]
+        nlohmann::json histogram = nlohmann::json::array();
+        for (int b = 0; b < PROFILER_BUCKETS; b++) {
+            if (p->buckets[b] > 0) histogram.push_back({std::round(b * PROFILER_BUCKET_MS * 1000.0) / 1000.0, p->buckets[b]});
+        }
+        entry["histogram"] = histogram;
+
+        json["phases"][phaseName(phase)] = entry;
+    }
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        Logger_log(LOGGER_ERROR, "PROFILER: Couldn't open %s for writing", path.c_str());
+        return false;
+    }
+    file << json.dump(4);
+
+    Logger_log(LOGGER_INFO, "PROFILER: Saved %llu frames to %s (p50 %.2fms, p99 %.2fms)",
+        (unsigned long long)phases[PROFILE_FRAME].count, path.c_str(), percentile(PROFILE_FRAME, 50), percentile(PROFILE_FRAME, 99));
+    return true;
+}
+
+const char* Profiler::phaseName(ProfilerPhase phase) {
+    switch (phase) {
+        case PROFILE_INPUT: return "input";
+        case PROFILE_UPDATE: return "update";
+        case PROFILE_DRAW: return "draw";
+        case PROFILE_SWAP: return "swap";
+        case PROFILE_PRESENT: return "present";
+        case PROFILE_FRAME: return "frame";
+        default: return "unknown";
+    }
+}
\ No newline at end of file
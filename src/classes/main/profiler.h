@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// what a frame gets split into
+typedef enum {
+    PROFILE_INPUT,   // gsgl_PollEvents
+    PROFILE_UPDATE,  // Handler::update
+    PROFILE_DRAW,    // Renderer::draw, without the input/swap/present parts
+    PROFILE_SWAP,    // gsgl_SwapBuffers
+    PROFILE_PRESENT, // gsgl_Draw
+    PROFILE_FRAME,   // all of the above, start to end
+
+    PROFILE_PHASES
+} ProfilerPhase;
+
+// histograms are fixed size, 0.1ms per bucket up to 100ms. anything slower goes in the last one
+#define PROFILER_BUCKETS 1000
+#define PROFILER_BUCKET_MS 0.1
+
+class Profiler {
+    public:
+        Profiler();
+
+        void begin(ProfilerPhase phase);
+        void end(ProfilerPhase phase);
+
+        double percentile(ProfilerPhase phase, double p); // in ms
+        bool dump(std::string path);
+
+        static const char* phaseName(ProfilerPhase phase);
+
+    private:
+        typedef struct {
+            double started;
+
+            uint32_t buckets[PROFILER_BUCKETS];
+            uint64_t count;
+            double total; // ms
+            double max;   // ms
+        } Phase;
+
+        Phase phases[PROFILE_PHASES];
+};
\ No newline at end of file
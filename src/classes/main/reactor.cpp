@@ -0,0 +1,181 @@
+#include "reactor.h"
+
+#ifndef _WIN32
+
+#include "../../logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#define REACTOR_MAX_EVENTS 64
+
+Reactor::Reactor() {
+    // do nothing
+}
+
+void Reactor::init() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (epollFd < 0 || wakeFd < 0 || timerFd < 0) {
+        Logger_log(LOGGER_ERROR, "REACTOR: Couldn't create epoll/eventfd/timerfd (errno %d)", errno);
+        throw "Reactor initialization failed";
+    }
+
+    // both just need draining, the actual work happens after epoll_wait returns
+    watch(wakeFd, EPOLLIN, [this](uint32_t) {
+        uint64_t value;
+        while (read(wakeFd, &value, sizeof(value)) > 0) {}
+    });
+    watch(timerFd, EPOLLIN, [this](uint32_t) {
+        uint64_t expirations;
+        while (read(timerFd, &expirations, sizeof(expirations)) > 0) {}
+    });
+
+    Logger_log(LOGGER_INFO, "REACTOR: Initialized");
+}
+void Reactor::close() {
+    if (epollFd >= 0) ::close(epollFd);
+    if (wakeFd >= 0) ::close(wakeFd);
+    if (timerFd >= 0) ::close(timerFd);
+
+    epollFd = wakeFd = timerFd = -1;
+    watchers.clear();
+    timers.clear();
+}
+
+// fds
+void Reactor::watch(int fd, uint32_t events, std::function<void(uint32_t events)> callback) {
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+
+    bool existing = watchers.find(fd) != watchers.end();
+    watchers[fd] = callback;
+
+    if (epoll_ctl(epollFd, existing ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) != 0) {
+        Logger_log(LOGGER_WARNING, "REACTOR: Couldn't watch fd %d (errno %d)", fd, errno);
+    }
+}
+void Reactor::modify(int fd, uint32_t events) {
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+}
+void Reactor::unwatch(int fd) {
+    if (watchers.erase(fd) == 0) return;
+
+    // fails with EBADF if the fd is already closed, which is fine, epoll forgot about it by itself
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+// timers
+double Reactor::now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+int Reactor::addTimer(double seconds, std::function<void()> callback) {
+    int id = nextTimerId++;
+    timers.push_back({id, now() + std::max(seconds, 0.0), callback});
+    armTimers();
+
+    return id;
+}
+void Reactor::cancelTimer(int id) {
+    timers.erase(std::remove_if(timers.begin(), timers.end(), [id](const Timer& timer) { return timer.id == id; }), timers.end());
+    armTimers();
+}
+
+void Reactor::armTimers() {
+    itimerspec spec = {};
+
+    if (timers.empty() == false) {
+        double deadline = timers[0].deadline;
+        for (const Timer& timer : timers) deadline = std::min(deadline, timer.deadline);
+
+        // an all-zero it_value would disarm it instead
+        double whole;
+        double fraction = std::modf(deadline, &whole);
+        spec.it_value.tv_sec = (time_t)whole;
+        spec.it_value.tv_nsec = std::max((long)(fraction * 1000000000.0), 1L);
+    }
+
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+void Reactor::runTimers() {
+    if (timers.empty()) return;
+
+    // pull out the ones that are due first, callbacks are allowed to add new timers
+    double current = now();
+    std::vector<Timer> due;
+    for (auto it = timers.begin(); it != timers.end();) {
+        if (it->deadline <= current) {
+            due.push_back(*it);
+            it = timers.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    for (Timer& timer : due) timer.callback();
+    armTimers();
+}
+
+// cross-thread
+void Reactor::post(std::function<void()> func) {
+    {
+        std::lock_guard<std::mutex> guard(postLock);
+        posted.push_back(func);
+    }
+    wake();
+}
+void Reactor::wake() {
+    uint64_t one = 1;
+    write(wakeFd, &one, sizeof(one));
+}
+void Reactor::runPosted() {
+    std::vector<std::function<void()>> funcs;
+    {
+        std::lock_guard<std::mutex> guard(postLock);
+        funcs.swap(posted);
+    }
+
+    for (auto& func : funcs) func();
+}
+
+// the loop itself
+void Reactor::run(double timeout) {
+    int timeoutMs = -1;
+    if (timeout >= 0) timeoutMs = (int)std::ceil(timeout * 1000.0);
+
+    epoll_event events[REACTOR_MAX_EVENTS];
+    int count = epoll_wait(epollFd, events, REACTOR_MAX_EVENTS, timeoutMs);
+    if (count < 0 && errno != EINTR) {
+        Logger_log(LOGGER_WARNING, "REACTOR: epoll_wait failed (errno %d)", errno);
+    }
+
+    // everything that's ready gets handled in one go
+    for (int i = 0; i < count; i++) {
+        // a callback before this one might have unwatched it
+        auto it = watchers.find(events[i].data.fd);
+        if (it == watchers.end()) continue;
+
+        std::function<void(uint32_t)> callback = it->second;
+        callback(events[i].events);
+    }
+
+    runTimers();
+    runPosted();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+// Linux only. Windows still runs the old loop, GetMessage blocks there anyway.
+#ifndef _WIN32
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <sys/epoll.h>
+
+// one epoll loop for everything the main thread waits on:
+// the X connection, network sockets, timers and work finished on other threads
+class Reactor {
+    public:
+        Reactor();
+
+        void init();
+        void close();
+
+        // runs the callback with the ready epoll events (EPOLLIN etc) whenever the fd is ready
+        void watch(int fd, uint32_t events, std::function<void(uint32_t events)> callback);
+        void modify(int fd, uint32_t events);
+        void unwatch(int fd);
+
+        // one-shot, returns an id for cancelTimer
+        int addTimer(double seconds, std::function<void()> callback);
+        void cancelTimer(int id);
+
+        // these two are safe to call from any thread
+        void post(std::function<void()> func); // runs func on the main thread
+        void wake();
+
+        // waits up to timeout seconds (negative waits forever) and runs everything that became ready
+        void run(double timeout);
+
+        static double now();
+
+    private:
+        typedef struct {
+            int id;
+            double deadline;
+            std::function<void()> callback;
+        } Timer;
+
+        void armTimers();
+        void runTimers();
+        void runPosted();
+
+        int epollFd = -1;
+        int wakeFd = -1;  // eventfd
+        int timerFd = -1; // timerfd, armed for the earliest timer
+
+        std::map<int, std::function<void(uint32_t events)>> watchers;
+
+        std::vector<Timer> timers;
+        int nextTimerId = 1;
+
+        std::mutex postLock;
+        std::vector<std::function<void()>> posted;
+};
+
+#endif
\ No newline at end of file
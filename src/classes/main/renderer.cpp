@@ -13,19 +13,39 @@ Renderer::Renderer() {
 
 void Renderer::init() {
     // initialize window
-    gsgl_SoftwareRender();
+    if (headless == true) gsgl_HeadlessRender();
+    else gsgl_SoftwareRender();
     gsgl_InitWindow(1600, 900, "webkitten");
-    gsgl_SetFrameRate(60);
+
+    // headless is for benchmarking, no point in waiting.
+    // on linux the main loop sleeps between frames by itself
+    #ifdef _WIN32
+    gsgl_SetFrameRate(headless ? 0 : frameRate);
+    #else
+    gsgl_SetFrameRate(0);
+    #endif
+    gsgl_TiledRender(0); // spread rasterizing over every core
+    gsgl_RetainedRender(true); // the chrome barely ever changes, don't redraw it every frame
 
     Logger_log(LOGGER_INFO, "----------------------------------------------------------------------------------");
 
     LoadFonts();
+
+    startTime = gsgl_GetTime();
 }
 void Renderer::update() {
     
 }
 void Renderer::draw() {
+    profiler->begin(PROFILE_INPUT);
     gsgl_PollEvents();
+    profiler->end(PROFILE_INPUT);
+    dirty = false;
+
+    // F12 saves frame timings so far
+    if (gsgl_IsKeyPressed(KEY_F12)) profiler->dump("profile.json");
+
+    profiler->begin(PROFILE_DRAW);
 
     // draw the top bar
     gsgl_Rect(0, 0, gsgl_GetScreenWidth(), 32, {48, 48, 48, 255});
@@ -94,19 +114,50 @@ void Renderer::draw() {
     bool historyBackward = ui_BasicButton(GetFont(PROGGY_CLEAN), "B", 16, {4, 32 + 4}, {24, 24}, {255, 255, 255, 255}, {64, 64, 64, 255}, {128, 128, 128, 255}, {160, 160, 160, 255});
     bool historyForward = ui_BasicButton(GetFont(PROGGY_CLEAN), "F", 16, {4 + 32, 32 + 4}, {24, 24}, {255, 255, 255, 255}, {64, 64, 64, 255}, {128, 128, 128, 255}, {160, 160, 160, 255});
     bool reloadPage = ui_BasicButton(GetFont(PROGGY_CLEAN), "R", 16, {4 + 64, 32 + 4}, {24, 24}, {255, 255, 255, 255}, {64, 64, 64, 255}, {128, 128, 128, 255}, {160, 160, 160, 255});
+    if (reloadPage == true && handler != nullptr) handler->reloadTab(handler->tabFocus);
 
     // draw the page
     handler->draw();
 
+    profiler->end(PROFILE_DRAW);
+
     gsgl_Clear({0, 0, 0, 255});
+
+    profiler->begin(PROFILE_SWAP);
     gsgl_SwapBuffers();
+    profiler->end(PROFILE_SWAP);
+
+    profiler->begin(PROFILE_PRESENT);
     gsgl_Draw();
+    profiler->end(PROFILE_PRESENT);
+
+    frames++;
+    if (frameLimit > 0 && frames >= frameLimit) closing = true;
+
+    // dragging, key repeat and such need frames even if no new events come in
+    if (gsgl_IsInputHeld()) dirty = true;
 }
 
 void Renderer::close() {
     closing = true;
+
+    if (headless == true && frames > 0) {
+        double elapsed = gsgl_GetTime() - startTime;
+        Logger_log(LOGGER_INFO, "Rendered %d frames in %f (%f per frame)", frames, elapsed, elapsed / frames);
+    }
+    if (dumpPath.empty() == false) {
+        if (gsgl_SaveFramePPM(dumpPath.c_str())) Logger_log(LOGGER_INFO, "Saved the last frame to %s", dumpPath.c_str());
+    }
+
     gsgl_CloseWindow();
 }
 bool Renderer::shouldClose() {
     return closing || gsgl_ShouldClose();
+}
+
+void Renderer::invalidate() {
+    dirty = true;
+}
+bool Renderer::isDirty() {
+    return dirty;
 }
\ No newline at end of file
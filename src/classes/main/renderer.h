@@ -2,6 +2,8 @@
 
 #include "../../internal/gsgl/gsgl.h"
 
+#include <string>
+
 class Renderer {
     public:
         Renderer();
@@ -13,6 +15,19 @@ class Renderer {
         void close();
         bool shouldClose();
 
+        // only used by the reactor loop, everywhere else draws every frame
+        void invalidate();
+        bool isDirty();
+        int frameRate = 60;
+
+        // headless runs, set from the command line before init
+        bool headless = false;
+        int frameLimit = 0;     // closes after this many frames, 0 runs forever
+        std::string dumpPath;   // the last frame gets saved here as a ppm
+
     private:
         bool closing = false;
+        bool dirty = true;
+        int frames = 0;
+        double startTime = 0;
 };
\ No newline at end of file
@@ -1,10 +1,13 @@
 #include "request.h"
 #include "../../main.h"
 #include "../../logger.h"
+#include <algorithm>
+#include <cctype>
 #include <string>
 
 Request::Request(std::string m_url) {
     url = m_url;
+    cacheKey = HttpCache::normalize(m_url);
     reqType = REQTYPE_UNKNOWN;
     reqState = REQSTATE_UNKNOWN;
 
@@ -25,30 +28,163 @@ Request::Request(std::string m_url) {
         networker->SetInstanceDef(curl);
         curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writer);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &resBody);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerWriter);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, this);
 
         reqState = REQSTATE_READY;
     }
 }
 
-size_t Request::writer(char *data, size_t size, size_t nmemb, std::string *writerData) {
-  if(writerData == NULL)
+Request::~Request() {
+    cancel();
+    if (curl) curl_easy_cleanup(curl);
+    if (extraHeaders) curl_slist_free_all(extraHeaders);
+}
+
+// straight from curl_multi, so this is on the UI thread too. listeners see every piece the moment it's here
+size_t Request::writer(char *data, size_t size, size_t nmemb, Request *request) {
+  if(request == NULL)
     return 0;
- 
-  writerData->append(data, size*nmemb);
- 
+
+  // the first piece of body means the headers before it were the last ones (no 100 Continue or such)
+  if (request->headersDelivered == false) {
+    long status = 0;
+    curl_easy_getinfo(request->curl, CURLINFO_RESPONSE_CODE, &status);
+    request->deliverHeaders(status, request->resHeaders);
+  }
+
+  // in first, so getReceived has it by the time the listener asks
+  request->resBody.append(data, size*nmemb);
+  request->deliverChunk(std::string_view(data, size * nmemb));
+
+  // something new to show
+  renderer->invalidate();
+
   return size * nmemb;
 }
 
-void Request::send() {
+// one header line at a time, the status line starts a new set (redirects, 100 Continue)
+size_t Request::headerWriter(char *data, size_t size, size_t nmemb, Request *request) {
+    std::string line(data, size * nmemb);
+    while (line.empty() == false && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+
+    if (line.rfind("HTTP/", 0) == 0) {
+        request->resHeaders.clear();
+        return size * nmemb;
+    }
+
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+        size_t start = line.find_first_not_of(" \t", colon + 1);
+        request->resHeaders.push_back({name, start != std::string::npos ? line.substr(start) : ""});
+    }
+    return size * nmemb;
+}
+
+void Request::send(bool reload) {
     if (reqState != REQSTATE_READY) return;
 
-    CURLcode res = curl_easy_perform(curl);
-    if (res == CURLE_OK) {
-        onFinishedLambda(REQRES_OK, resBody);
+    resBody.clear();
+    resHeaders.clear();
+    headersDelivered = false;
+    revalidating = false;
+    if (extraHeaders) curl_slist_free_all(extraHeaders);
+    extraHeaders = NULL;
+
+    if (reqType != REQTYPE_POST) {
+        const HttpCacheEntry* cached = networker->cache.lookup(cacheKey);
+
+        // fresh enough to not even ask, it's handed over right away
+        if (cached != NULL && reload == false && networker->cache.isFresh(cached)) {
+            HttpBuffer body;
+            if (networker->cache.readBody(cached, &body)) {
+                // all there already, shared as it is instead of going through onChunk
+                deliverHeaders(cached->status, cached->headers);
+                if (onFinishedLambda) onFinishedLambda(REQRES_OK, body);
+                return;
+            }
+            networker->cache.remove(cacheKey);
+            cached = NULL;
+        }
+
+        // otherwise the server only has to send it again if it changed
+        if (cached != NULL) {
+            if (cached->etag.empty() == false) extraHeaders = curl_slist_append(extraHeaders, ("If-None-Match: " + cached->etag).c_str());
+            if (cached->lastModified.empty() == false) extraHeaders = curl_slist_append(extraHeaders, ("If-Modified-Since: " + cached->lastModified).c_str());
+            revalidating = extraHeaders != NULL;
+        }
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, extraHeaders);
+
+    // doesn't wait for anything, see finish()
+    reqState = REQSTATE_WORKING;
+    if (networker->start(this, curl) == false) {
+        // never got going, fail it here so it doesn't stay working forever
+        finish(CURLE_FAILED_INIT);
+    }
+}
+void Request::cancel() {
+    if (reqState != REQSTATE_WORKING) return;
+
+    networker->cancel(curl);
+    reqState = REQSTATE_READY;
+}
+void Request::finish(CURLcode code) {
+    // the handle can be sent again after this
+    reqState = REQSTATE_READY;
+
+    // from here on it's read-only and shared
+    HttpBuffer body = std::make_shared<const std::string>(std::move(resBody));
+    resBody.clear();
+
+    if (code != CURLE_OK) {
+        Logger_log(LOGGER_WARNING, "NETWORK: Request to %s failed: %s", url.c_str(), curl_easy_strerror(code));
+        if (onFinishedLambda) onFinishedLambda(REQRES_ERROR, body);
+        return;
+    }
+
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+    if (revalidating == true && status == 304) {
+        // still the same, the cached body is the response
+        const HttpCacheEntry* cached = networker->cache.lookup(cacheKey);
+        if (cached != NULL && networker->cache.readBody(cached, &body)) {
+            networker->cache.refresh(cacheKey, resHeaders);
+
+            // a 304 has no body of its own, listeners get the cached one whole in onFinished
+            deliverHeaders(cached->status, cached->headers);
+        } else {
+            // it's gone from disk since, ask again without the conditions
+            networker->cache.remove(cacheKey);
+            send();
+            return;
+        }
     } else {
-        // handle it later
+        // nothing in the body, nothing told the listeners yet
+        if (headersDelivered == false) deliverHeaders(status, resHeaders);
+        if (reqType != REQTYPE_POST) networker->cache.store(cacheKey, status, resHeaders, body);
     }
+
+    if (onFinishedLambda) onFinishedLambda(REQRES_OK, body);
+}
+
+void Request::deliverHeaders(long status, const HttpHeaders& headers) {
+    headersDelivered = true;
+    if (onHeadersLambda) onHeadersLambda(status, headers);
+}
+void Request::deliverChunk(std::string_view chunk) {
+    if (chunk.empty() == false && onChunkLambda) onChunkLambda(chunk);
+}
+bool Request::isWorking() {
+    return reqState == REQSTATE_WORKING;
+}
+std::string_view Request::getReceived() {
+    return resBody;
 }
 
 void Request::get() {
@@ -58,6 +194,12 @@ void Request::post() {
     reqType = REQTYPE_POST;
 }
 
-void Request::onFinished(std::function<void(RequestResponseState res, std::string m_resBody)> func) {
+void Request::onHeaders(std::function<void(long status, const HttpHeaders& headers)> func) {
+    onHeadersLambda = func;
+}
+void Request::onChunk(std::function<void(std::string_view chunk)> func) {
+    onChunkLambda = func;
+}
+void Request::onFinished(std::function<void(RequestResponseState res, HttpBuffer m_resBody)> func) {
     onFinishedLambda = func;
 }
\ No newline at end of file
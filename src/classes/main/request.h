@@ -2,8 +2,10 @@
 
 #include <functional>
 #include <string>
+#include <string_view>
 
 #include <curl/curl.h>
+#include "httpcache.h"
 #include "../../logger.h"
 
 typedef enum {
@@ -21,28 +23,58 @@ typedef enum {
 } RequestState;
 typedef enum {
     REQRES_OK,
+    REQRES_ERROR
 } RequestResponseState;
 
+// a handle for one transfer. send() only starts it, the Networker calls finish() on the UI thread once it's done.
+// while it's running the body is handed out as it comes in: onHeaders, then onChunk for every piece, then onFinished.
+// a cached response is already complete, so it goes from onHeaders straight to onFinished without any chunks
 class Request {
     public:
         Request(std::string m_url);
+        ~Request();
+
+        Request(const Request&) = delete;
+        Request& operator=(const Request&) = delete;
 
         void get();
         void post();
 
-        static size_t writer(char *data, size_t size, size_t nmemb, std::string *writerData);
-        void send();
+        static size_t writer(char *data, size_t size, size_t nmemb, Request *request);
+        static size_t headerWriter(char *data, size_t size, size_t nmemb, Request *request);
+        void send(bool reload = false); // reload revalidates whatever's cached, even if it's still fresh
+        void cancel();
+        void finish(CURLcode code);
+
+        bool isWorking();
+        // everything that came in so far, good until the next chunk or until it finishes
+        std::string_view getReceived();
 
-        // event listeners
-        void onFinished(std::function<void(RequestResponseState res, std::string resBody)> func);
+        // event listeners, all of them on the UI thread
+        void onHeaders(std::function<void(long status, const HttpHeaders& headers)> func);
+        // points straight into curl's buffer, only good until the listener returns. see getReceived for all of it
+        void onChunk(std::function<void(std::string_view chunk)> func);
+        // the whole body, every chunk put together. shared with the caches, nothing gets copied on the way
+        void onFinished(std::function<void(RequestResponseState res, HttpBuffer resBody)> func);
 
     private:
         RequestState reqState;
         RequestType reqType;
         std::string url;
+        std::string cacheKey; // the normalized url
         CURL* curl;
 
+        void deliverHeaders(long status, const HttpHeaders& headers);
+        void deliverChunk(std::string_view chunk);
+
         std::string resBody;
+        HttpHeaders resHeaders;
+        bool headersDelivered = false; // the final ones, only known once the body starts or it's done
+
+        bool revalidating = false;             // asked the server if the cached one is still good
+        struct curl_slist* extraHeaders = NULL; // the conditional ones for that
 
-        std::function<void(RequestResponseState res, std::string m_resBody)> onFinishedLambda;
+        std::function<void(long status, const HttpHeaders& headers)> onHeadersLambda;
+        std::function<void(std::string_view chunk)> onChunkLambda;
+        std::function<void(RequestResponseState res, HttpBuffer m_resBody)> onFinishedLambda;
 };
\ No newline at end of file
@@ -1,8 +1,15 @@
 #include "tab.h"
 
+#include "../../main.h"
 #include "../../internal/gsgl/gsgl.h"
 #include "../ui/fonts.h"
 
+#include <algorithm>
+
+#define DOCUMENT_LEFT 16
+#define DOCUMENT_TOP 80
+#define DOCUMENT_TEXT_SIZE 16
+
 static int currentId = 0;
 
 Tab::Tab(std::string m_address) {
@@ -15,11 +22,35 @@ Tab::Tab(std::string m_address) {
 void Tab::init() {
     testReq = new Request(address);
 
-    auto onFinished = [this](RequestResponseState res, std::string m_resBody){
+    // all of these come in on the UI thread. the page shows up with the first chunk, not after the last one
+    auto onHeaders = [this](long, const HttpHeaders&){
+        streaming = true;
+        document = std::string_view();
+        resultChanged = true;
+    };
+    auto onChunk = [this](std::string_view){
+        if (streaming == false) return;
+
+        // the request keeps the bytes, this just looks at them
+        document = testReq->getReceived();
+        resultGrew = true;
+    };
+    auto onFinished = [this](RequestResponseState res, HttpBuffer m_resBody){
+        // nothing came in, whatever's shown stays
+        if (streaming == false && res != REQRES_OK) return;
+
+        // after streaming it's the same bytes (what made it, if it failed), so the line index still holds.
+        // a cached one shows up all at once and gets indexed from scratch
+        if (streaming == false || document.size() != m_resBody->size()) resultChanged = true;
+        streaming = false;
+
         requestResult = m_resBody;
-        //printf("%s\n", requestResult.c_str());
+        document = *requestResult;
+        //printf("%s\n", requestResult->c_str());
     };
 
+    testReq->onHeaders(onHeaders);
+    testReq->onChunk(onChunk);
     testReq->onFinished(onFinished);
 }
 void Tab::update() {
@@ -28,13 +59,181 @@ void Tab::update() {
         testReq->get();
         testReq->send();
     }
+
+    if (focused == true && lineHeight > 0) {
+        int page = std::max(gsgl_GetScreenHeight() - DOCUMENT_TOP - lineHeight, lineHeight);
+
+        scrollBy(-gsgl_GetMouseWheel() * lineHeight * 3);
+        if (gsgl_IsKeyRepeat(KEY_DOWN)) scrollBy(lineHeight);
+        if (gsgl_IsKeyRepeat(KEY_UP)) scrollBy(-lineHeight);
+        if (gsgl_IsKeyRepeat(KEY_PAGE_DOWN)) scrollBy(page);
+        if (gsgl_IsKeyRepeat(KEY_PAGE_UP)) scrollBy(-page);
+        if (gsgl_IsKeyPressed(KEY_HOME)) scrollBy(-scrollY);
+        if (gsgl_IsKeyPressed(KEY_END)) scrollBy((int)lineStarts.size() * lineHeight);
+    }
 }
 void Tab::draw() {
-    gsgl_DrawText(GetFont(PROGGY_CLEAN), requestResult.c_str(), 16, 80, 16, {255, 255, 255, 255});
+    GSGL_Font font = GetFont(PROGGY_CLEAN);
+
+    // wrap at however many characters fit, proggy is monospaced so this is exact for it.
+    // runs keep fractional advances, so the width has to come from one
+    if (charWidth <= 0) {
+        GSGL_TextRun sample = gsgl_CreateTextRun(font, "M", DOCUMENT_TEXT_SIZE);
+        charWidth = std::max(sample.width, 1);
+        gsgl_UnloadTextRun(sample);
+    }
+    int columns = std::max((gsgl_GetScreenWidth() - DOCUMENT_LEFT * 2) / charWidth, 16);
+
+    // the index only gets built again when the result or the window width changes,
+    // a page that's still coming in only gets its new part indexed
+    if (resultChanged == true || columns != lineColumns) {
+        lineHeight = gsgl_GetLineHeight(font, DOCUMENT_TEXT_SIZE);
+        buildLineIndex(columns);
+        scrollBy(0);
+        resultChanged = false;
+        resultGrew = false;
+    } else if (resultGrew == true) {
+        extendLineIndex();
+        resultGrew = false;
+    }
+    if (lineHeight <= 0) return;
+
+    int firstLine = std::max(scrollY / lineHeight, 0);
+    int lastLine = std::min((scrollY + gsgl_GetScreenHeight() - DOCUMENT_TOP) / lineHeight, (int)lineStarts.size() - 1);
+
+    // a page above and below gets laid out too, so their glyphs are already rasterizing before they scroll in
+    int page = lastLine - firstLine + 1;
+    int firstLaidOut = std::max(firstLine - page, 0);
+    int lastLaidOut = std::min(lastLine + page, (int)lineStarts.size() - 1);
+
+    // runs that scrolled away get thrown out
+    for (auto it = lineRuns.begin(); it != lineRuns.end();) {
+        if (it->first < firstLaidOut || it->first > lastLaidOut) {
+            gsgl_UnloadTextRun(it->second);
+            coldLines.erase(it->first);
+            it = lineRuns.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    // all the layout happens before anything gets drawn
+    for (int line = firstLaidOut; line <= lastLaidOut; line++) {
+        if (lineRuns.find(line) != lineRuns.end()) continue;
+
+        size_t start = lineStarts[line];
+        size_t end = line + 1 < (int)lineStarts.size() ? lineStarts[line + 1] : document.size();
+
+        // the line break isn't part of the line
+        while (end > start && (document[end - 1] == '\n' || document[end - 1] == '\r')) end--;
+
+        std::string text(document.substr(start, end - start));
+        lineRuns.emplace(line, gsgl_CreateTextRun(font, text.c_str(), DOCUMENT_TEXT_SIZE));
+        coldLines.insert(line);
+    }
+
+    // below the address bar. a line whose glyphs aren't rasterized yet shows up a frame later instead of
+    // holding this one up, the workers are already on it
+    bool waiting = false;
+    gsgl_ScissorsStart(0, 64, gsgl_GetScreenWidth(), gsgl_GetScreenHeight() - 64);
+    for (int line = firstLine; line <= lastLine; line++) {
+        if (coldLines.count(line) > 0) {
+            if (gsgl_IsTextRunReady(&lineRuns[line]) == false) {
+                waiting = true;
+                continue;
+            }
+            coldLines.erase(line);
+        }
+        gsgl_DrawTextRun(&lineRuns[line], DOCUMENT_LEFT, DOCUMENT_TOP + line * lineHeight - scrollY, {255, 255, 255, 255});
+    }
+    gsgl_ScissorsStop();
+
+    if (waiting == true) renderer->invalidate();
 }
 
 void Tab::close() {
     // we got asked to close! clear resources. and get the hell out of here
+    stopStreaming();
+    delete testReq;
+    testReq = NULL;
+
+    for (auto& line : lineRuns) gsgl_UnloadTextRun(line.second);
+    lineRuns.clear();
+    coldLines.clear();
+    lineStarts.clear();
+    resultChanged = true;
+}
+
+void Tab::reload() {
+    if (testReq == NULL) return;
+
+    // whatever's cached gets revalidated, so only what changed comes over the network
+    stopStreaming();
+    testReq->cancel();
+    busy = true;
+    testReq->get();
+    testReq->send(true);
+}
+
+// document
+// back to the last complete page, what the request had is about to go away
+void Tab::stopStreaming() {
+    if (streaming == false) return;
+
+    streaming = false;
+    document = *requestResult;
+    resultChanged = true;
+}
+
+// lines end at \n or once they're columns characters long
+void Tab::buildLineIndex(int columns) {
+    for (auto& line : lineRuns) gsgl_UnloadTextRun(line.second);
+    lineRuns.clear();
+    coldLines.clear();
+
+    lineStarts.clear();
+    lineStarts.push_back(0);
+    lineColumns = columns;
+    indexedBytes = 0;
+    indexedCharacters = 0;
+
+    extendLineIndex();
+}
+// picks up where the index stopped, so a page coming in a chunk at a time is still only looked at once
+void Tab::extendLineIndex() {
+
+    // the last line might go on now, its run has to be laid out again
+    auto last = lineRuns.find((int)lineStarts.size() - 1);
+    if (last != lineRuns.end()) {
+        gsgl_UnloadTextRun(last->second);
+        coldLines.erase(last->first);
+        lineRuns.erase(last);
+    }
+
+    int characters = indexedCharacters;
+    for (size_t i = indexedBytes; i < document.size(); i++) {
+        unsigned char byte = (unsigned char)document[i];
+        if ((byte & 0xC0) == 0x80) continue; // the middle of a UTF-8 character
+
+        if (byte == '\n') {
+            lineStarts.push_back(i + 1);
+            characters = 0;
+            continue;
+        }
+
+        if (characters == lineColumns) {
+            lineStarts.push_back(i);
+            characters = 0;
+        }
+        characters++;
+    }
+
+    indexedBytes = document.size();
+    indexedCharacters = characters;
+}
+void Tab::scrollBy(int pixels) {
+    int maxScroll = std::max((int)lineStarts.size() * lineHeight - (gsgl_GetScreenHeight() - DOCUMENT_TOP), 0);
+    scrollY = std::clamp(scrollY + pixels, 0, maxScroll);
 }
 
 std::string Tab::getTitle() {
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "../main/request.h"
+#include "../../internal/gsgl/gsgl.h"
 
+#include <map>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Tab {
@@ -14,6 +18,7 @@ class Tab {
         void draw();
 
         void close();
+        void reload();
 
         std::string getTitle();
         std::string getAddress();
@@ -21,6 +26,11 @@ class Tab {
 
         void setFocusState(bool state);
 
+        // document
+        void buildLineIndex(int columns);
+        void extendLineIndex();
+        void scrollBy(int pixels);
+
         //RenderTexture2D tex;
     private:
         bool focused = false;
@@ -29,9 +39,27 @@ class Tab {
 
         std::string title = "";
         std::string address = "";
-        std::string requestResult = "There's nothing here buddy";
+        HttpBuffer requestResult = std::make_shared<const std::string>("There's nothing here buddy");
+        bool resultChanged = true;
+
+        // what's drawn. requestResult, or whatever the request has of the page that's still coming in. never a copy
+        std::string_view document = *requestResult;
+        void stopStreaming();
+        bool streaming = false;
+        bool resultGrew = false;
+
+        // only what's on screen gets laid out and drawn, a big page costs the same as a small one
+        std::vector<size_t> lineStarts; // byte offset of every line, wrapped lines included
+        int lineColumns = 0;             // what the index was wrapped at
+        size_t indexedBytes = 0;         // how far into the document the index got
+        int indexedCharacters = 0;       // how long the last line was by then
+        int lineHeight = 0;
+        int charWidth = 0;
+        int scrollY = 0;
+        std::map<int, GSGL_TextRun> lineRuns; // the visible lines, laid out
+        std::set<int> coldLines;              // laid out, but their glyphs might still be rasterizing
         int id = -1;
 
-        Request *testReq;
+        Request *testReq = NULL;
         std::vector<Request> requestQueue;
 };
\ No newline at end of file
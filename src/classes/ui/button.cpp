@@ -11,8 +11,8 @@ bool ui_BasicButton(GSGL_Font font, const char* txt, int textSize, Vector2i pos,
 
     gsgl_Rect(pos.x, pos.y, size.x, size.y, hovered == true ? (held == true ? clickColor : onColor) : offColor);
 
-    Vector2i txtSize = gsgl_GetTextSize(font, txt, float(textSize));
-    gsgl_DrawText(font, txt, pos.x + (size.x/2) - (txtSize.x/2), pos.y + (size.y/2) - (txtSize.y/2), float(textSize), textColor);
+    const GSGL_TextMetrics* txtSize = gsgl_MeasureText(font, txt, float(textSize));
+    gsgl_DrawText(font, txt, pos.x + (size.x/2) - (txtSize->width/2), pos.y + (size.y/2) - (txtSize->height/2), float(textSize), textColor);
 
     if (hovered == true) gsgl_SetCursor(GSGL_CLICK);
 
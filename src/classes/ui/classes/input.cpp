@@ -32,6 +32,7 @@ void Input::reset(bool fromEnter) {
 
     if (fromEnter == false) {
         currentText = "";
+        caretDirty = true;
         entered = false;
     }
 }
@@ -42,6 +43,7 @@ void Input::update() {
             focus = true;
             selectionStart = int(currentText.length());
             if (resetOnFocus == true) currentText = "";
+            caretDirty = true;
         }
 
         gsgl_SetCursor(GSGL_TEXT);
@@ -56,6 +58,7 @@ void Input::update() {
         if (chr != 0 && chr != KEY_BACKSPACE && chr >= 33 && chr <= 126 || chr == KEY_SPACE) {
             if (selectionSize != 0) selectionErase();
             currentText.insert(currentText.begin() + selectionStart, chr);
+            caretDirty = true;
 
             selectionStart++;
             textLength++;
@@ -92,6 +95,7 @@ void Input::update() {
                 std::string data = dataChar;
                 selectionErase();
                 currentText.insert(currentText.begin() + selectionStart, data.begin(), data.end());
+                caretDirty = true;
                 selectionStart += (int)data.length();
                 textLength += (int)data.length();
                 selectionSize = 0;
@@ -112,9 +116,9 @@ void Input::update() {
 
         // handle offseting
         // TODO: make the offsetting only happen when the selection is moved
-        Vector2i textWidth = gsgl_GetTextSize(font, currentText.substr(0, selectionStart).c_str(), float(textSize));
-        if (textWidth.x >= size.x) {
-            offset = {-(textWidth.x - size.x - 1), 0};
+        int caretX = caretOffset(selectionStart);
+        if (caretX >= size.x) {
+            offset = {-(caretX - size.x - 1), 0};
         } else {
             offset = {0, 0};
         }
@@ -136,31 +140,38 @@ void Input::draw() {
     // TODO: Multi-line rendering
     gsgl_DrawText(font, txtToUse, pos.x+offset.x, pos.y+offset.y, float(textSize), colToUse);
     if (selectionStart >= 0 && focus == true) {
+        int start = caretOffset(selectionStart);
+        int end = caretOffset(selectionStart + selectionSize);
+
         if (selectionSize == 0) {
-            Vector2i textWidth = gsgl_GetTextSize(font, currentText.substr(0, selectionStart).c_str(), float(textSize));
-            gsgl_Rect(pos.x+textWidth.x+1+offset.x, pos.y+offset.y, 1, textSize, currentTextColor);
+            gsgl_Rect(pos.x+start+1+offset.x, pos.y+offset.y, 1, textSize, currentTextColor);
         } else if (selectionSize > 0) {
-            Vector2i textWidthSelectStart = gsgl_GetTextSize(font, currentText.substr(0, selectionStart).c_str(), float(textSize));
-            Vector2i textWidthSelectSize = gsgl_GetTextSize(font, currentText.substr(selectionStart, selectionSize).c_str(), float(textSize));
-
-            gsgl_Rect(pos.x+textWidthSelectStart.x+textWidthSelectSize.x+1+offset.x, pos.y+offset.y, 1, textSize, currentTextColor);
-            gsgl_Rect(pos.x+textWidthSelectStart.x+1+offset.x, pos.y+int(textSize*0.9)+offset.y, textWidthSelectSize.x, int(textSize*0.1), currentTextColor);
+            gsgl_Rect(pos.x+end+1+offset.x, pos.y+offset.y, 1, textSize, currentTextColor);
+            gsgl_Rect(pos.x+start+1+offset.x, pos.y+int(textSize*0.9)+offset.y, end-start, int(textSize*0.1), currentTextColor);
         } else if (selectionSize < 0) {
-            Vector2i textWidthSelect = gsgl_GetTextSize(font, currentText.substr(0, selectionStart+selectionSize).c_str(), float(textSize));
-            Vector2i textWidthSelectStart = gsgl_GetTextSize(font, currentText.substr(0, selectionStart).c_str(), float(textSize));
-            Vector2i textWidthSelectSize = gsgl_GetTextSize(font, currentText.substr(selectionStart+selectionSize, -selectionSize).c_str(), float(textSize));
-
-            gsgl_Rect(pos.x+textWidthSelect.x+offset.x, pos.y+offset.y, 1, textSize, currentTextColor);
-            gsgl_Rect(pos.x+textWidthSelectStart.x-textWidthSelectSize.x+offset.x, pos.y+int(textSize*0.9)+offset.y, textWidthSelectSize.x, int(textSize*0.1), currentTextColor);
+            gsgl_Rect(pos.x+end+offset.x, pos.y+offset.y, 1, textSize, currentTextColor);
+            gsgl_Rect(pos.x+end+offset.x, pos.y+int(textSize*0.9)+offset.y, start-end, int(textSize*0.1), currentTextColor);
         }
     }
 
     gsgl_ScissorsStop();
 }
 
+// how far into the text the caret is when it's before character index
+// the advances get measured once per edit, every other frame this is just indexing into them
+int Input::caretOffset(int index) {
+    if (caretDirty == true) {
+        const GSGL_TextMetrics* metrics = gsgl_MeasureText(font, currentText.c_str(), float(textSize));
+        caretAdvances.assign(metrics->advances, metrics->advances + metrics->length + 1);
+        caretDirty = false;
+    }
+    return caretAdvances[std::max(0, std::min(index, (int)caretAdvances.size() - 1))];
+}
+
 // selection functions
 void Input::selectionErase() {
     selectionStart++;
+    caretDirty = true;
 
     if (selectionSize == 0) {
         if (selectionStart > 0) selectionStart--;
@@ -194,6 +205,7 @@ void Input::setDefaultText(std::string txt) {
 }
 void Input::setText(std::string txt) {
     currentText = txt;
+    caretDirty = true;
 }
 std::string Input::getText() {
     return currentText;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "../../../internal/gsgl/gsgl.h"
 
@@ -14,6 +15,7 @@ class Input {
 
         // selection functions
         void selectionErase();
+        int caretOffset(int index);
 
         // text functions
         void setPosition(Vector2i m_pos);
@@ -38,6 +40,10 @@ class Input {
         std::string defaultText;
         std::string currentText;
 
+        // caret positions for currentText, only measured again after it changes
+        std::vector<int> caretAdvances;
+        bool caretDirty = true;
+
         int selectionStart;
         int selectionSize;
         bool focus;
@@ -1,6 +1,10 @@
 #include "../../internal/gsgl/gsgl.h"
 #include "../../logger.h"
 
+// generated at build time, see CMakeLists.txt
+#include "ProggyClean.embedded.h"
+#include "ProggyClean.baked.h"
+
 // VARIABLES
 static GSGL_Font proggyClean;
 static GSGL_Font proggyTiny;
@@ -32,22 +36,27 @@ void LoadFonts() {
 
     Logger_log(LOGGER_INFO, "FONTS: Registering fonts");
 
-    proggyClean = gsgl_LoadFont("assets/fonts/ProggyClean.ttf");
+    // the UI font is in the binary, with the sizes the chrome uses already rasterized
+    proggyClean = gsgl_LoadFontFromMemory(proggyCleanData, sizeof(proggyCleanData), "ProggyClean.ttf (embedded)");
     if (IsFontReady(proggyClean)) {
-        Logger_log(LOGGER_INFO, "FONTS: ProggyClean.ttf loaded");
+        gsgl_AddBakedGlyphs(proggyClean, &proggyCleanBaked);
+        Logger_log(LOGGER_INFO, "FONTS: ProggyClean.ttf registered (embedded, %d baked glyphs)", proggyCleanBaked.glyphCount);
     } else {
         Logger_log(LOGGER_ERROR, "FONTS: ProggyClean.ttf didn't load!");
-        Logger_log(LOGGER_ERROR, "This is a integral font of the application and we don't have a embedded variant at the moment.");
         gsgl_CloseWindow();
     }
 
+    // these only check the files are there, gsgl maps them the first time they get drawn with
     proggyTiny = gsgl_LoadFont("assets/fonts/ProggyTiny.ttf");
     if (IsFontReady(proggyTiny)) {
-        Logger_log(LOGGER_INFO, "FONTS: ProggyTiny.ttf loaded");
+        Logger_log(LOGGER_INFO, "FONTS: ProggyTiny.ttf registered");
     } else {
         Logger_log(LOGGER_ERROR, "FONTS: ProggyTiny.ttf didn't load!");
     }
 
+    // anything proggy doesn't have comes out of the other bundled fonts, only opened when that happens
+    gsgl_AddFallbackDirectory("assets/fonts");
+
     Logger_log(LOGGER_INFO, "FONTS: Fonts registered");
 }
 void UnloadFonts() {
@@ -62,6 +71,8 @@ void UnloadFonts() {
         Logger_log(LOGGER_INFO, "FONTS: ProggyTiny.ttf unloaded");
     }
 
+    gsgl_UnloadFallbackFonts();
+
     Logger_log(LOGGER_INFO, "FONTS: Fonts unloaded");
 }
 GSGL_Font GetFont(GameFont font) {
@@ -0,0 +1,436 @@
+// Generic Software Graphics Library (GSGL)
+// Designed for software rendering specifically
+// Heavily inspired by raylib
+
+// Blending kernels
+// Every translucent draw ends up here. There's a scalar version that works everywhere,
+// and SSE2/AVX2 versions that get picked at startup if the CPU has them.
+
+/*
+
+The math is the same for every kernel, so they all give the exact same result:
+
+    out = (src * a + dst * (255 - a) + 128) / 255
+
+done per channel with integers (the divide is the usual "(x + (x >> 8)) >> 8" trick).
+Alpha is blended like the other channels, so a fully transparent source leaves the destination untouched
+and a fully opaque one replaces it.
+
+Mask spans (glyphs) are a solid color with a per-pixel 8-bit coverage. The coverage times the color's alpha
+becomes the source alpha, and from there it's the same equation, so a mask blit comes out exactly like
+blitting (coverage << 24 | rgb) as an image would.
+
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../../logger.h"
+#include "gsgl.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define GSGL_BLEND_X86
+
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #include <immintrin.h>
+
+        // msvc lets you use any intrinsic anywhere
+        #define GI_TARGET_SSE2
+        #define GI_TARGET_AVX2
+    #else
+        #include <cpuid.h>
+        #include <immintrin.h>
+
+        // gcc and clang need to be told which functions are allowed to use what
+        #define GI_TARGET_SSE2 __attribute__((target("sse2")))
+        #define GI_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+typedef void (*gi_BlendSpanFunc)(uint32_t* dst, const uint32_t* src, int count);
+typedef void (*gi_BlendSpanColorFunc)(uint32_t* dst, uint32_t color, int count);
+typedef void (*gi_BlendMaskSpanFunc)(uint32_t* dst, const uint8_t* mask, uint32_t color, int count);
+
+void gi_InitBlendKernels();
+
+// == SCALAR
+// red/blue and alpha/green get packed into one register each, so this is 2 multiplies per pixel instead of 4.
+static inline uint32_t gi_BlendPixel(uint32_t d, uint32_t srcRB, uint32_t srcAG, uint32_t inv) {
+    uint32_t rb = (d & 0x00FF00FF) * inv + srcRB;
+    uint32_t ag = ((d >> 8) & 0x00FF00FF) * inv + srcAG;
+
+    // divide every lane by 255
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+
+    return rb | ag;
+}
+
+static void gi_BlendSpanScalar(uint32_t* dst, const uint32_t* src, int count) {
+    for (int i = 0; i < count; i++) {
+        uint32_t s = src[i];
+        uint32_t alpha = s >> 24;
+
+        if (alpha == 0) continue;
+        if (alpha == 255) {
+            dst[i] = s;
+            continue;
+        }
+
+        uint32_t srcRB = (s & 0x00FF00FF) * alpha + 0x00800080;
+        uint32_t srcAG = ((s >> 8) & 0x00FF00FF) * alpha + 0x00800080;
+        dst[i] = gi_BlendPixel(dst[i], srcRB, srcAG, 255 - alpha);
+    }
+}
+static void gi_BlendSpanColorScalar(uint32_t* dst, uint32_t color, int count) {
+    // the source side of the equation is the same for every pixel so it only gets computed once
+    uint32_t alpha = color >> 24;
+    uint32_t srcRB = (color & 0x00FF00FF) * alpha + 0x00800080;
+    uint32_t srcAG = ((color >> 8) & 0x00FF00FF) * alpha + 0x00800080;
+
+    for (int i = 0; i < count; i++) {
+        dst[i] = gi_BlendPixel(dst[i], srcRB, srcAG, 255 - alpha);
+    }
+}
+
+static void gi_BlendMaskSpanScalar(uint32_t* dst, const uint8_t* mask, uint32_t color, int count) {
+    uint32_t colorAlpha = color >> 24;
+    uint32_t rgb = color & 0x00FFFFFF;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t alpha = mask[i];
+        if (colorAlpha != 255) {
+            uint32_t x = alpha * colorAlpha + 128;
+            alpha = (x + (x >> 8)) >> 8;
+        }
+
+        if (alpha == 0) continue;
+        if (alpha == 255) {
+            dst[i] = 0xFF000000 | rgb;
+            continue;
+        }
+
+        uint32_t srcRB = (rgb & 0x00FF00FF) * alpha + 0x00800080;
+        uint32_t srcAG = ((alpha << 16) | ((rgb >> 8) & 0xFF)) * alpha + 0x00800080;
+        dst[i] = gi_BlendPixel(dst[i], srcRB, srcAG, 255 - alpha);
+    }
+}
+
+#ifdef GSGL_BLEND_X86
+// == SSE2
+// 4 pixels at a time. every channel gets widened to 16 bits so the multiplies can't overflow.
+GI_TARGET_SSE2 static inline __m128i gi_Div255SSE2(__m128i x) {
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+GI_TARGET_SSE2 static inline __m128i gi_BroadcastAlphaSSE2(__m128i x) {
+    // channel 3 and 7 are the alpha of the two pixels
+    x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+GI_TARGET_SSE2 static void gi_BlendSpanSSE2(uint32_t* dst, const uint32_t* src, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i half = _mm_set1_epi16(128);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+
+        // skip the math when all 4 are fully transparent or fully opaque. glyphs are mostly like this
+        __m128i sa = _mm_and_si128(s, alphaMask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, zero)) == 0xFFFF) continue;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, alphaMask)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i*)(dst + i), s);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+        __m128i sLo = _mm_unpacklo_epi8(s, zero);
+        __m128i sHi = _mm_unpackhi_epi8(s, zero);
+        __m128i dLo = _mm_unpacklo_epi8(d, zero);
+        __m128i dHi = _mm_unpackhi_epi8(d, zero);
+
+        __m128i aLo = gi_BroadcastAlphaSSE2(sLo);
+        __m128i aHi = gi_BroadcastAlphaSSE2(sHi);
+
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(sLo, aLo), _mm_mullo_epi16(dLo, _mm_sub_epi16(full, aLo))), half);
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(sHi, aHi), _mm_mullo_epi16(dHi, _mm_sub_epi16(full, aHi))), half);
+
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(gi_Div255SSE2(lo), gi_Div255SSE2(hi)));
+    }
+
+    gi_BlendSpanScalar(dst + i, src + i, count - i);
+}
+GI_TARGET_SSE2 static void gi_BlendSpanColorSSE2(uint32_t* dst, uint32_t color, int count) {
+    const __m128i zero = _mm_setzero_si128();
+
+    uint16_t alpha = (uint16_t)(color >> 24);
+    __m128i c = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+    __m128i srcPremul = _mm_add_epi16(_mm_mullo_epi16(c, _mm_set1_epi16(alpha)), _mm_set1_epi16(128));
+    __m128i inv = _mm_set1_epi16(255 - alpha);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv), srcPremul);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv), srcPremul);
+
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(gi_Div255SSE2(lo), gi_Div255SSE2(hi)));
+    }
+
+    gi_BlendSpanColorScalar(dst + i, color, count - i);
+}
+
+GI_TARGET_SSE2 static void gi_BlendMaskSpanSSE2(uint32_t* dst, const uint8_t* mask, uint32_t color, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+    uint16_t colorAlpha = (uint16_t)(color >> 24);
+    __m128i scale = _mm_set1_epi16(colorAlpha);
+    __m128i opaque = _mm_set1_epi32((int)(0xFF000000 | color));
+    __m128i rgb = _mm_unpacklo_epi8(_mm_set1_epi32((int)(color & 0x00FFFFFF)), zero);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32_t coverage;
+        memcpy(&coverage, mask + i, sizeof(coverage));
+
+        // empty and solid runs are most of a glyph
+        if (coverage == 0) continue;
+        if (coverage == 0xFFFFFFFF && colorAlpha == 255) {
+            _mm_storeu_si128((__m128i*)(dst + i), opaque);
+            continue;
+        }
+
+        // one 16-bit alpha per channel: m0 m0 m0 m0 m1 m1 m1 m1 and m2 .. m3
+        __m128i m = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)coverage), zero);
+        if (colorAlpha != 255) m = gi_Div255SSE2(_mm_add_epi16(_mm_mullo_epi16(m, scale), half));
+        m = _mm_unpacklo_epi16(m, m);
+        __m128i aLo = _mm_unpacklo_epi32(m, m);
+        __m128i aHi = _mm_unpackhi_epi32(m, m);
+
+        // the source's alpha channel is the alpha itself
+        __m128i sLo = _mm_or_si128(rgb, _mm_and_si128(aLo, alphaLanes));
+        __m128i sHi = _mm_or_si128(rgb, _mm_and_si128(aHi, alphaLanes));
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i dLo = _mm_unpacklo_epi8(d, zero);
+        __m128i dHi = _mm_unpackhi_epi8(d, zero);
+
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(sLo, aLo), _mm_mullo_epi16(dLo, _mm_sub_epi16(full, aLo))), half);
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(sHi, aHi), _mm_mullo_epi16(dHi, _mm_sub_epi16(full, aHi))), half);
+
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(gi_Div255SSE2(lo), gi_Div255SSE2(hi)));
+    }
+
+    gi_BlendMaskSpanScalar(dst + i, mask + i, color, count - i);
+}
+
+// == AVX2
+// same thing as SSE2, 8 pixels at a time. unpack and pack work per 128-bit half so the pixel order stays intact.
+GI_TARGET_AVX2 static inline __m256i gi_Div255AVX2(__m256i x) {
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+GI_TARGET_AVX2 static inline __m256i gi_BroadcastAlphaAVX2(__m256i x) {
+    x = _mm256_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+GI_TARGET_AVX2 static void gi_BlendSpanAVX2(uint32_t* dst, const uint32_t* src, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i half = _mm256_set1_epi16(128);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+
+        __m256i sa = _mm256_and_si256(s, alphaMask);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, zero)) == -1) continue;
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(sa, alphaMask)) == -1) {
+            _mm256_storeu_si256((__m256i*)(dst + i), s);
+            continue;
+        }
+
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+
+        __m256i sLo = _mm256_unpacklo_epi8(s, zero);
+        __m256i sHi = _mm256_unpackhi_epi8(s, zero);
+        __m256i dLo = _mm256_unpacklo_epi8(d, zero);
+        __m256i dHi = _mm256_unpackhi_epi8(d, zero);
+
+        __m256i aLo = gi_BroadcastAlphaAVX2(sLo);
+        __m256i aHi = gi_BroadcastAlphaAVX2(sHi);
+
+        __m256i lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(sLo, aLo), _mm256_mullo_epi16(dLo, _mm256_sub_epi16(full, aLo))), half);
+        __m256i hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(sHi, aHi), _mm256_mullo_epi16(dHi, _mm256_sub_epi16(full, aHi))), half);
+
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(gi_Div255AVX2(lo), gi_Div255AVX2(hi)));
+    }
+
+    gi_BlendSpanSSE2(dst + i, src + i, count - i);
+}
+GI_TARGET_AVX2 static void gi_BlendSpanColorAVX2(uint32_t* dst, uint32_t color, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+
+    uint16_t alpha = (uint16_t)(color >> 24);
+    __m256i c = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), zero);
+    __m256i srcPremul = _mm256_add_epi16(_mm256_mullo_epi16(c, _mm256_set1_epi16(alpha)), _mm256_set1_epi16(128));
+    __m256i inv = _mm256_set1_epi16(255 - alpha);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv), srcPremul);
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv), srcPremul);
+
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(gi_Div255AVX2(lo), gi_Div255AVX2(hi)));
+    }
+
+    gi_BlendSpanColorSSE2(dst + i, color, count - i);
+}
+
+GI_TARGET_AVX2 static void gi_BlendMaskSpanAVX2(uint32_t* dst, const uint8_t* mask, uint32_t color, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i full = _mm256_set1_epi16(255);
+    const __m256i half = _mm256_set1_epi16(128);
+    const __m256i alphaLanes = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+
+    uint16_t colorAlpha = (uint16_t)(color >> 24);
+    __m256i scale = _mm256_set1_epi32(colorAlpha);
+    __m256i opaque = _mm256_set1_epi32((int)(0xFF000000 | color));
+    __m256i rgb = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)(color & 0x00FFFFFF)), zero);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint64_t coverage;
+        memcpy(&coverage, mask + i, sizeof(coverage));
+
+        if (coverage == 0) continue;
+        if (coverage == 0xFFFFFFFFFFFFFFFFULL && colorAlpha == 255) {
+            _mm256_storeu_si256((__m256i*)(dst + i), opaque);
+            continue;
+        }
+
+        // one coverage per 32-bit lane, pixels 0-3 in the low half and 4-7 in the high one, same as the pixels
+        __m256i m = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(mask + i)));
+        if (colorAlpha != 255) m = gi_Div255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(m, scale), half));
+        m = _mm256_or_si256(m, _mm256_slli_epi32(m, 16));
+        __m256i aLo = _mm256_unpacklo_epi32(m, m);
+        __m256i aHi = _mm256_unpackhi_epi32(m, m);
+
+        __m256i sLo = _mm256_or_si256(rgb, _mm256_and_si256(aLo, alphaLanes));
+        __m256i sHi = _mm256_or_si256(rgb, _mm256_and_si256(aHi, alphaLanes));
+
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i dLo = _mm256_unpacklo_epi8(d, zero);
+        __m256i dHi = _mm256_unpackhi_epi8(d, zero);
+
+        __m256i lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(sLo, aLo), _mm256_mullo_epi16(dLo, _mm256_sub_epi16(full, aLo))), half);
+        __m256i hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(sHi, aHi), _mm256_mullo_epi16(dHi, _mm256_sub_epi16(full, aHi))), half);
+
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(gi_Div255AVX2(lo), gi_Div255AVX2(hi)));
+    }
+
+    gi_BlendMaskSpanSSE2(dst + i, mask + i, color, count - i);
+}
+
+// == CPU DETECTION
+static void gi_Cpuid(int regs[4], int leaf, int subleaf) {
+    #ifdef _MSC_VER
+    __cpuidex(regs, leaf, subleaf);
+    #else
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+    regs[0] = (int)a; regs[1] = (int)b; regs[2] = (int)c; regs[3] = (int)d;
+    #endif
+}
+static unsigned long long gi_Xgetbv() {
+    #ifdef _MSC_VER
+    return _xgetbv(0);
+    #else
+    unsigned int a = 0, d = 0;
+    __asm__ volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return ((unsigned long long)d << 32) | a;
+    #endif
+}
+
+static bool gi_CpuHasSSE2() {
+    int regs[4];
+    gi_Cpuid(regs, 0, 0);
+    if (regs[0] < 1) return false;
+
+    gi_Cpuid(regs, 1, 0);
+    return (regs[3] & (1 << 26)) != 0;
+}
+static bool gi_CpuHasAVX2() {
+    int regs[4];
+    gi_Cpuid(regs, 0, 0);
+    if (regs[0] < 7) return false;
+
+    // the cpu having AVX isn't enough, the OS also has to save the YMM registers for us
+    gi_Cpuid(regs, 1, 0);
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    bool avx = (regs[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((gi_Xgetbv() & 0x6) != 0x6) return false;
+
+    gi_Cpuid(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+}
+#endif
+
+// == DISPATCH
+static struct {
+    const char* name;
+    gi_BlendSpanFunc span;
+    gi_BlendSpanColorFunc spanColor;
+    gi_BlendMaskSpanFunc maskSpan;
+} blendKernels = { "scalar", gi_BlendSpanScalar, gi_BlendSpanColorScalar, gi_BlendMaskSpanScalar };
+
+void gi_InitBlendKernels() {
+    #ifdef GSGL_BLEND_X86
+    if (gi_CpuHasAVX2()) {
+        blendKernels = { "AVX2", gi_BlendSpanAVX2, gi_BlendSpanColorAVX2, gi_BlendMaskSpanAVX2 };
+    } else if (gi_CpuHasSSE2()) {
+        blendKernels = { "SSE2", gi_BlendSpanSSE2, gi_BlendSpanColorSSE2, gi_BlendMaskSpanSSE2 };
+    }
+    #endif
+
+    Logger_log(LOGGER_INFO, "GRAPHICS: - Using %s blending kernels", blendKernels.name);
+}
+
+void gsgl_BlendSpan(uint32_t* dst, const uint32_t* src, int count) {
+    if (count <= 0) return;
+    blendKernels.span(dst, src, count);
+}
+void gsgl_BlendSpanColor(uint32_t* dst, uint32_t color, int count) {
+    if (count <= 0) return;
+
+    uint32_t alpha = color >> 24;
+    if (alpha == 0) return;
+    if (alpha == 255) {
+        for (int i = 0; i < count; i++) dst[i] = color;
+        return;
+    }
+
+    blendKernels.spanColor(dst, color, count);
+}
+void gsgl_BlendMaskSpan(uint32_t* dst, const uint8_t* mask, uint32_t color, int count) {
+    if (count <= 0) return;
+    if ((color >> 24) == 0) return;
+
+    blendKernels.maskSpan(dst, mask, color, count);
+}
+const char* gsgl_GetBlendKernelName() {
+    return blendKernels.name;
+}
\ No newline at end of file
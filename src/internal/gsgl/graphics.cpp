@@ -73,37 +73,60 @@ Now here's a couple of quirks:
 Optimizations:
 - The clear thing. I've mentioned it above.
 
-- Normally doing SwapBuffers would do it for ALL pixels. This is not very performant. So we're gonna use a box.
-  This box is basically like the Scissors mode. Expect its set when you do BufferAccess. It'll do comparing, and it'll set if it needs to.
-  Changing the clear color also forces the box to the screen's resolution.
-  Internally, this is called WriteBox. If you need to manipulate this in some way, there's a WriteBoxSet function.
-  BufferAccess also calls WriteBoxUpdate.
+- SwapBuffers doesn't copy anything. There are 2 or 3 framebuffers (gsgl_SetBufferCount), each with its own image for presenting,
+  and swapping just rotates which one is on-screen and which one gets drawn into.
 
-  This may seem like a pointless optimization, but even on modern systems at most it's a 5% CPU usage reduction.
-  Such reduction may be very benefical in older hardware.
+- We also track damage. Every draw adds the rect it touched to a small list of dirty rects (overlapping or nearby ones get merged).
+  A framebuffer only gets the rects it had drawn into cleared when it comes back around, and only the rows that actually changed
+  from the last frame get sent to the window in gsgl_Draw.
+  Changing the clear color damages the whole screen. If you need to manipulate this in some way, there's gsgl_DamageRect.
+
+  So if a frame only moves the caret or changes a hovered tab, only those few rows go through XPutImage.
 
   This is not in effect if you're using a hardware renderer
 
+- Rects don't go through BufferAccess. They get clipped against the screen and the scissors once, then whole rows get filled.
+  Opaque colors are a plain store, translucent ones get blended a row at a time.
+
+- Blending is done with integers, a whole span at a time (see blend.cpp). Rects, text and images all share the same kernels,
+  and the SSE2/AVX2 variants get picked during gsgl_InitWindow based on what the CPU supports.
+
+- gsgl_TiledRender records draws instead, sorts them into 64x64 tiles and rasterizes the tiles on a few threads
+  during SwapBuffers (see tiles.cpp). Worth it for full repaints, like scrolling a long page.
+  On top of that, gsgl_RetainedRender hashes what got drawn into every tile and skips tiles that came out the same as last frame,
+  so a frame where nothing changed costs about as much as hashing it.
+
 Some things to keep in mind:
 - All functions start with "gsgl_". This is to prevent conflict with windows.h specifically
 - The renderer mode must be set BEFORE gsgl_InitWindow.
+- gsgl_HeadlessRender is the software renderer without a window. Nothing touches X11 or win32, input comes from gsgl_Inject*
+  and frames can be written out with gsgl_SaveFramePPM. Meant for benchmarks and pixel checks on machines with no display.
 
 */
 
 #include <cstdint>
+#include <cstdio>
+#include <algorithm>
 #include <chrono>
 #include <time.h>
 #include <cmath>
 #include <iostream>
 
 #ifdef _WIN32
+#define NOMINMAX // windows.h min/max macros break std::min and std::max
 #include <comdef.h>
 #include <windows.h>
 #include <windowsx.h>
 #else
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/XKBlib.h>
 #include <string.h> // for some weird reason you need to include this for memset
+#ifdef GSGL_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
 #endif
 
 #include "../../logger.h"
@@ -112,6 +135,9 @@ Some things to keep in mind:
 #define SUPPORT_WINMM_HIGHRES_TIMER      1
 #define SUPPORT_PARTIALBUSY_WAIT_LOOP    1
 #define KEYBOARD_KEYS                    512
+#define MOUSE_BUTTONS                    3
+#define GSGL_MAX_BUFFERS                 3
+#define GSGL_MAX_INJECTED_EVENTS         256
 
 #ifdef _WIN32
 typedef struct Win32Core {
@@ -132,18 +158,64 @@ typedef struct LinuxCore {
     bool destroyed;
 
     struct {
-        XImage* image;
+        XImage* images[GSGL_MAX_BUFFERS]; // one per framebuffer, so flipping doesn't need to recreate anything
 
         int depth;
         XVisualInfo vinfo;
         XGCValues gcv;
         unsigned long gcm;
         GC context;
+
+        #ifdef GSGL_XSHM
+        // MIT-SHM. the framebuffers live in memory shared with the X server, so presenting doesn't go through the socket
+        struct {
+            bool available;     // the server has the extension
+            int completionType; // event type of ShmCompletion
+
+            bool active[GSGL_MAX_BUFFERS];  // the image is a shared one
+            bool pending[GSGL_MAX_BUFFERS]; // the server might still be reading the image
+            XShmSegmentInfo info[GSGL_MAX_BUFFERS];
+        } Shm;
+        #endif
     } Graphics;
 } LinuxCore;
 LinuxCore platformCore = { 0 };
 #endif
 
+#define GSGL_DAMAGE_RECTS                16
+#define GSGL_DAMAGE_MERGE_SLACK          4096 // how many extra pixels a merge is allowed to cover
+
+typedef struct gi_DamageList {
+    Recti rects[GSGL_DAMAGE_RECTS];
+    int count;
+} gi_DamageList;
+
+// input that didn't come from the window, see gsgl_Inject*
+typedef enum {
+    GI_INJECT_KEY,
+    GI_INJECT_BUTTON,
+    GI_INJECT_MOVE,
+    GI_INJECT_CHAR,
+    GI_INJECT_RESIZE,
+    GI_INJECT_WHEEL,
+} gi_InjectedEventType;
+
+typedef struct gi_InjectedEvent {
+    gi_InjectedEventType type;
+    int a; // key, button, x, char or width
+    int b; // y or height
+    bool down;
+} gi_InjectedEvent;
+
+typedef struct gi_Framebuffer {
+    uint32_t* pixels;
+
+    // what got drawn into it the last time it was the off-screen buffer.
+    // everything else is still the clear color, so that's all that needs clearing when it comes back around
+    gi_DamageList drawn;
+    uint32_t clearColor;
+} gi_Framebuffer;
+
 typedef struct GraphicsCore {
     bool ready;
     struct {
@@ -156,12 +228,18 @@ typedef struct GraphicsCore {
         // settings
         bool software;
         bool hardware;
+        bool headless; // software, but without a window
         int frameRate;
 
         // software rendering
         bool buffersInited;
-        uint32_t* buffer1; // off-screen
-        uint32_t* buffer2; // on-screen
+        gi_Framebuffer buffers[GSGL_MAX_BUFFERS];
+        int bufferCount;
+        int backBuffer;
+        int frontBuffer;
+
+        uint32_t* buffer1; // off-screen, always buffers[backBuffer]
+        uint32_t* buffer2; // on-screen, always buffers[frontBuffer]
 
         uint32_t swapBufferClear;
 
@@ -179,21 +257,30 @@ typedef struct GraphicsCore {
 
         // optimization. software renderer only
         struct {
-            int startX;
-            int startY;
-            int endX;
-            int endY;
-        } WriteBox;
+            gi_DamageList current;  // drawn into the off-screen buffer this frame
+            gi_DamageList previous; // drawn into the on-screen buffer, the frame before
+            gi_DamageList present;  // changed on-screen, still has to be sent to the window
+        } Damage;
     } Graphics;
 
     struct {
         GSGL_MouseInputObject mouseNew;
-        GSGL_MouseInputObject mouseOld;
+        GSGL_MouseInputObject mouseFrame; // as of the last PollEvents
 
         bool keysNew[KEYBOARD_KEYS];
-        bool keysOld[KEYBOARD_KEYS];
         int keysRepeat[KEYBOARD_KEYS];
 
+        // edges since the last PollEvents, so a tap that's down and up again before the next frame still counts
+        bool keysPressed[KEYBOARD_KEYS];
+        bool keysReleased[KEYBOARD_KEYS];
+        bool buttonsPressed[MOUSE_BUTTONS];
+        bool buttonsReleased[MOUSE_BUTTONS];
+        // and what the current frame got out of them
+        bool keysPressedFrame[KEYBOARD_KEYS];
+        bool keysReleasedFrame[KEYBOARD_KEYS];
+        bool buttonsPressedFrame[MOUSE_BUTTONS];
+        bool buttonsReleasedFrame[MOUSE_BUTTONS];
+
         char lastChar;
 
         int repeatDelay;
@@ -201,6 +288,10 @@ typedef struct GraphicsCore {
 
         GSGL_Cursor cursorStyle;
         bool cursorChanged;
+
+        // applied on the next PollEvents
+        gi_InjectedEvent injected[GSGL_MAX_INJECTED_EVENTS];
+        int injectedCount;
     } Input;
 
     struct { // This part is directly taken from raylib
@@ -221,10 +312,51 @@ GraphicsCore core = { 0 };
 #ifndef _WIN32
 GSGL_Key gi_XSymToGSGLKey(KeySym sym);
 #endif
+bool gi_InitPlatformWindow(int width, int height, const char* title);
+void gi_ApplyInjectedEvents();
+void gi_Inject(gi_InjectedEvent event);
+void gi_SetKey(int key, bool down);
+void gi_SetMouseButton(GSGL_MouseButton button, bool down);
 void gi_UpdateSettings();
 void gi_ResizeWindow(int width, int height);
 void gi_InitBuffers();
 
+bool gi_ClipRect(int* x0, int* y0, int* x1, int* y1);
+void gi_FillRect(int x0, int y0, int x1, int y1, uint32_t color);
+void gi_DrawMask(const uint8_t* mask, int stride, int x, int y, int width, int height, Color col, uint64_t key);
+
+void gi_DamageAdd(gi_DamageList* list, Recti rect);
+void gi_DamageCompareRect(Recti rect);
+void gi_DamageClearRect(uint32_t* buffer, Recti rect, uint32_t color);
+
+void gi_FlipBuffers();
+void gi_PrepareBackBuffer();
+
+void gi_InitBlendKernels(); // blend.cpp
+// text.cpp
+void gi_TextEndFrame();
+void gi_GlyphWorkersStop();
+
+// tiles.cpp
+bool gi_TilesActive();
+void gi_TilesStart(int threads);
+void gi_TilesStop();
+void gi_TilesReset();
+void gi_TilesSetRetained(bool retained);
+bool gi_TilesRetained();
+void gi_TilesInvalidate();
+void gi_TilesFill(Recti rect, uint32_t color);
+void gi_TilesImage(Recti rect, const uint32_t* pixels, int stride);
+void gi_TilesMask(Recti rect, const uint8_t* mask, int stride, uint32_t color);
+void gi_TilesMaskKeyed(Recti rect, const uint8_t* mask, int stride, uint32_t color, uint64_t key);
+void gi_TilesFlush(uint32_t* buffer, uint32_t clearColor, int bufferCount);
+
+#ifdef GSGL_XSHM
+bool gi_ShmCreateImage(int buffer);
+void gi_ShmDestroyImage(int buffer, bool wait);
+void gi_ShmWaitForPresent(int buffer);
+#endif
+
 #ifdef _WIN32
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
@@ -265,10 +397,40 @@ void gsgl_GetLastError() {
 void gsgl_SoftwareRender() {
     core.Graphics.software = true;
     core.Graphics.hardware = false;
+    core.Graphics.headless = false;
 }
 void gsgl_HardwareRender() {
     core.Graphics.software = false;
     core.Graphics.hardware = true;
+    core.Graphics.headless = false;
+}
+void gsgl_HeadlessRender() {
+    // still software rendering, it just never leaves memory
+    core.Graphics.software = true;
+    core.Graphics.hardware = false;
+    core.Graphics.headless = true;
+}
+void gsgl_TiledRender(int threads) {
+    gi_TilesFlush(core.Graphics.buffer1, core.Graphics.swapBufferClear, core.Graphics.bufferCount);
+    gi_TilesStart(threads);
+}
+void gsgl_ImmediateRender() {
+    gsgl_RetainedRender(false);
+    gi_TilesFlush(core.Graphics.buffer1, core.Graphics.swapBufferClear, core.Graphics.bufferCount);
+    gi_TilesStop();
+}
+void gsgl_RetainedRender(bool retained) {
+    if (gi_TilesRetained() == true && retained == false) {
+        // nothing kept track of what's in the framebuffers, so the lazy clear has to start from the whole thing
+        for (int i = 0; i < core.Graphics.bufferCount; i++) {
+            core.Graphics.buffers[i].drawn.count = 0;
+            gi_DamageAdd(&core.Graphics.buffers[i].drawn, {0, 0, core.Window.width, core.Window.height});
+        }
+    }
+    gi_TilesSetRetained(retained);
+}
+void gsgl_SetBufferCount(int count) {
+    core.Graphics.bufferCount = std::max(2, std::min(count, GSGL_MAX_BUFFERS));
 }
 
 void gsgl_InitWindow(int width, int height, const char *title) {
@@ -294,13 +456,22 @@ void gsgl_InitWindow(int width, int height, const char *title) {
     core.Graphics.Scissors.endX = 0;
     core.Graphics.Scissors.endY = 0;
 
-    core.Input.mouseOld = { 0 };
     core.Input.mouseNew = { 0 };
+    core.Input.mouseFrame = { 0 };
 
     for (int i = 0; i < KEYBOARD_KEYS; i++) {
-        core.Input.keysOld[i] = false;
         core.Input.keysNew[i] = false;
         core.Input.keysRepeat[i] = 0;
+        core.Input.keysPressed[i] = false;
+        core.Input.keysReleased[i] = false;
+        core.Input.keysPressedFrame[i] = false;
+        core.Input.keysReleasedFrame[i] = false;
+    }
+    for (int i = 0; i < MOUSE_BUTTONS; i++) {
+        core.Input.buttonsPressed[i] = false;
+        core.Input.buttonsReleased[i] = false;
+        core.Input.buttonsPressedFrame[i] = false;
+        core.Input.buttonsReleasedFrame[i] = false;
     }
 
     core.Input.lastChar = 0;
@@ -309,6 +480,54 @@ void gsgl_InitWindow(int width, int height, const char *title) {
 
     gi_UpdateSettings();
 
+    if (core.Graphics.headless == true) {
+        Logger_log(LOGGER_INFO, "GRAPHICS: - Running headless, no window gets created");
+    } else if (gi_InitPlatformWindow(width, height, title) == false) {
+        return;
+    }
+
+    // initialize framebuffers if needed
+    core.Window.width = width;
+    core.Window.height = height;
+
+    core.Graphics.buffersInited = false;
+
+    if (core.Graphics.software == true) {
+        Logger_log(LOGGER_INFO, "GRAPHICS: Starting software rendering initialization");
+
+        // so we're gonna play some tricks here.
+        // rather than be expensive and loop through the buffer during draw time again,
+        // we're just gonna set the off-screen buffer to the clear color the developer sets.
+        // clever right?
+
+        // there may be some reasons as to why this is probably not preferred, but i take this over a few cpu cycles wasted.
+        // it may be also just one damn loop extra. dont get me started on having 2 extra loops.
+
+        core.Graphics.swapBufferClear = 0;
+
+        Logger_log(LOGGER_INFO, "GRAPHICS: - Initializing framebuffers");
+        gi_InitBuffers();
+
+        Logger_log(LOGGER_INFO, "GRAPHICS: Software renderer prepared");
+    } else if (core.Graphics.hardware == true) {
+        Logger_log(LOGGER_INFO, "GRAPHICS: Starting hardware-accelerated rendering initialization");
+
+        throw "No hardware acceleration support!";
+
+        Logger_log(LOGGER_INFO, "GRAPHICS: Hardware-accelerated renderer prepared");
+    }
+
+    // pick the fastest blending the cpu can do
+    gi_InitBlendKernels();
+
+    // initiate timer
+    gsgl_InitTimer();
+
+    Logger_log(LOGGER_INFO, "GRAPHICS: Internal graphics library initialized");
+
+    core.ready = true;
+}
+bool gi_InitPlatformWindow(int width, int height, const char* title) {
     #ifdef _WIN32
     // set class name
     const char* className = "webkitten";
@@ -333,7 +552,7 @@ void gsgl_InitWindow(int width, int height, const char *title) {
 
     if (platformCore.Window.handle == NULL) {
         gsgl_GetLastError();
-        return;
+        return false;
     } else {
         Logger_log(LOGGER_INFO, "GRAPHICS: - Window successfully created");
     }
@@ -351,7 +570,7 @@ void gsgl_InitWindow(int width, int height, const char *title) {
     platformCore.display = XOpenDisplay(NULL);
     if (platformCore.display == NULL) {
         gsgl_GetLastError();
-        return;
+        return false;
     } else {
         Logger_log(LOGGER_INFO, "GRAPHICS: - Display successfully opened");
     }
@@ -370,7 +589,7 @@ void gsgl_InitWindow(int width, int height, const char *title) {
 
     if (!XMatchVisualInfo(platformCore.display, XDefaultScreen(platformCore.display), 24, TrueColor, &platformCore.Graphics.vinfo)) {
         Logger_log(LOGGER_ERROR, "GRAPHICS: No such visual graphics");
-        return;
+        return false;
     }
 
     XSync(platformCore.display, true);
@@ -394,14 +613,19 @@ void gsgl_InitWindow(int width, int height, const char *title) {
     
     if (platformCore.window == NULL) {
         gsgl_GetLastError();
-        return;
+        return false;
     } else {
         Logger_log(LOGGER_INFO, "GRAPHICS: - Window successfully created");
     }
 
-    platformCore.eventMask = StructureNotifyMask | ButtonPressMask | ButtonReleaseMask | KeyPressMask | KeyReleaseMask;
+    platformCore.eventMask = 
+        StructureNotifyMask | ExposureMask | ButtonPressMask | ButtonReleaseMask | KeyPressMask | KeyReleaseMask | 
+        PointerMotionMask | EnterWindowMask | LeaveWindowMask;
     XSelectInput(platformCore.display, platformCore.window, platformCore.eventMask);
 
+    // held keys only send more KeyPress events instead of a release and a press every repeat
+    XkbSetDetectableAutoRepeat(platformCore.display, True, NULL);
+
     // final graphics steps
     platformCore.Graphics.gcm = GCGraphicsExposures;
     platformCore.Graphics.gcv.graphics_exposures = 0;
@@ -410,6 +634,16 @@ void gsgl_InitWindow(int width, int height, const char *title) {
         platformCore.Graphics.gcm, &platformCore.Graphics.gcv
     );
 
+    #ifdef GSGL_XSHM
+    platformCore.Graphics.Shm.available = XShmQueryExtension(platformCore.display) == True;
+    if (platformCore.Graphics.Shm.available == true) {
+        platformCore.Graphics.Shm.completionType = XShmGetEventBase(platformCore.display) + ShmCompletion;
+        Logger_log(LOGGER_INFO, "GRAPHICS: - MIT-SHM is available");
+    } else {
+        Logger_log(LOGGER_INFO, "GRAPHICS: - MIT-SHM is not available, falling back to XPutImage");
+    }
+    #endif
+
     // show
     Logger_log(LOGGER_INFO, "GRAPHICS: - Showing window");
     XMapWindow(platformCore.display, platformCore.window);
@@ -420,43 +654,7 @@ void gsgl_InitWindow(int width, int height, const char *title) {
 
     #endif
 
-    // initialize framebuffers if needed
-    core.Window.width = width;
-    core.Window.height = height;
-
-    core.Graphics.buffersInited = false;
-
-    if (core.Graphics.software == true) {
-        Logger_log(LOGGER_INFO, "GRAPHICS: Starting software rendering initialization");
-
-        // so we're gonna play some tricks here.
-        // rather than be expensive and loop through the buffer during draw time again,
-        // we're just gonna set the off-screen buffer to the clear color the developer sets.
-        // clever right?
-
-        // there may be some reasons as to why this is probably not preferred, but i take this over a few cpu cycles wasted.
-        // it may be also just one damn loop extra. dont get me started on having 2 extra loops.
-
-        core.Graphics.swapBufferClear = 0;
-
-        Logger_log(LOGGER_INFO, "GRAPHICS: - Initializing framebuffers");
-        gi_InitBuffers();
-
-        Logger_log(LOGGER_INFO, "GRAPHICS: Software renderer prepared");
-    } else if (core.Graphics.hardware == true) {
-        Logger_log(LOGGER_INFO, "GRAPHICS: Starting hardware-accelerated rendering initialization");
-
-        throw "No hardware acceleration support!";
-
-        Logger_log(LOGGER_INFO, "GRAPHICS: Hardware-accelerated renderer prepared");
-    }
-
-    // initiate timer
-    gsgl_InitTimer();
-
-    Logger_log(LOGGER_INFO, "GRAPHICS: Internal graphics library initialized");
-
-    core.ready = true;
+    return true;
 }
 
 bool gsgl_WindowReady() {
@@ -493,26 +691,70 @@ void gsgl_PollEvents() {
     gsgl_WindowReady();
 
     // reset input states
+    // pressed/released come from the edges gi_SetKey and gi_SetMouseButton kept, so events drained in between still count
     core.Input.lastChar = 0;
-    core.Input.mouseOld = core.Input.mouseNew;
 
+    gi_ApplyInjectedEvents();
+
+    if (core.Graphics.headless == false) {
+        #ifdef _WIN32
+        int res = GetMessage(&platformCore.Window.msg, platformCore.Window.handle, 0, 0);
+        if (res == 0) {
+            gsgl_CloseWindow();
+        } else {
+            TranslateMessage(&platformCore.Window.msg);
+            DispatchMessage(&platformCore.Window.msg);
+        }
+        #else
+        gsgl_DrainEvents();
+        #endif
+    }
+
+    core.Input.mouseFrame = core.Input.mouseNew;
     for (int i = 0; i < KEYBOARD_KEYS; i++) {
-        core.Input.keysOld[i] = core.Input.keysNew[i];
+        core.Input.keysPressedFrame[i] = core.Input.keysPressed[i];
+        core.Input.keysReleasedFrame[i] = core.Input.keysReleased[i];
+        core.Input.keysPressed[i] = false;
+        core.Input.keysReleased[i] = false;
     }
-    
-    #ifdef _WIN32
-    int res = GetMessage(&platformCore.Window.msg, platformCore.Window.handle, 0, 0);
-    if (res == 0) {
-        gsgl_CloseWindow();
-    } else {
-        TranslateMessage(&platformCore.Window.msg);
-        DispatchMessage(&platformCore.Window.msg);
+    for (int i = 0; i < MOUSE_BUTTONS; i++) {
+        core.Input.buttonsPressedFrame[i] = core.Input.buttonsPressed[i];
+        core.Input.buttonsReleasedFrame[i] = core.Input.buttonsReleased[i];
+        core.Input.buttonsPressed[i] = false;
+        core.Input.buttonsReleased[i] = false;
     }
+
+    // the wheel adds up between frames, this frame has it now
+    core.Input.mouseNew.mouseScrollWheel = 0;
+}
+
+bool gsgl_DrainEvents() {
+    #ifdef _WIN32
+    return false;
     #else
+    if (core.Graphics.headless == true || platformCore.destroyed == true || platformCore.display == NULL) return false;
 
-    if (XPending(platformCore.display)) {
+    // everything that's queued up, not just one event per frame
+    bool redraw = false;
+    while (platformCore.destroyed == false && XPending(platformCore.display)) { // the window can get closed halfway through
         XEvent event;
         XNextEvent(platformCore.display, &event);
+
+        #ifdef GSGL_XSHM
+        // not a constant, so it can't be in the switch
+        if (platformCore.Graphics.Shm.available == true && event.type == platformCore.Graphics.Shm.completionType) {
+            XShmCompletionEvent* completion = (XShmCompletionEvent*)&event;
+            for (int i = 0; i < core.Graphics.bufferCount; i++) {
+                if (platformCore.Graphics.Shm.active[i] == true && platformCore.Graphics.Shm.info[i].shmseg == completion->shmseg) {
+                    platformCore.Graphics.Shm.pending[i] = false;
+                }
+            }
+            continue; // only means a buffer is free again, nothing to redraw
+        }
+        #endif
+
+        redraw = true;
+
         switch (event.type) {
             // Resizing
             case ConfigureNotify: {
@@ -521,44 +763,61 @@ void gsgl_PollEvents() {
                 break;
             }
 
+            // the window got uncovered, whatever was there is gone
+            case Expose: {
+                gsgl_DamagePresentFull();
+                break;
+            }
+
             // Input
             // since X11 handles keycodes in a different breed we need to translate the layouts to our own layout
             case KeyPress: {
                 XKeyPressedEvent* key = (XKeyPressedEvent*)&event;
                 GSGL_Key gsglKey = gi_XSymToGSGLKey(XKeycodeToKeysym(platformCore.display, key->keycode, 0));
-                core.Input.keysNew[(int)gsglKey] = true;
+                gi_SetKey((int)gsglKey, true);
                 break;
             }
             case KeyRelease: {
                 XKeyReleasedEvent* key = (XKeyReleasedEvent*)&event;
                 GSGL_Key gsglKey = gi_XSymToGSGLKey(XKeycodeToKeysym(platformCore.display, key->keycode, 0));
-                core.Input.keysNew[(int)gsglKey] = false;
+                gi_SetKey((int)gsglKey, false);
                 break;
             }
 
             // mouse buttons
             case ButtonPress: {
                 XButtonPressedEvent* btn = (XButtonPressedEvent*)&event;
-                if (btn->button == Button1) core.Input.mouseNew.leftMouseButton = true;
-                if (btn->button == Button2) core.Input.mouseNew.middleMouseButton = true;
-                if (btn->button == Button3) core.Input.mouseNew.rightMouseButton = true;
+                if (btn->button == Button1) gi_SetMouseButton(GSGL_LMB, true);
+                if (btn->button == Button2) gi_SetMouseButton(GSGL_MMB, true);
+                if (btn->button == Button3) gi_SetMouseButton(GSGL_RMB, true);
+
+                // X sends the wheel as buttons 4 and 5, one press per notch
+                if (btn->button == Button4) core.Input.mouseNew.mouseScrollWheel++;
+                if (btn->button == Button5) core.Input.mouseNew.mouseScrollWheel--;
                 break;
             }
             case ButtonRelease: {
                 XButtonReleasedEvent* btn = (XButtonReleasedEvent*)&event;
-                if (btn->button == Button1) core.Input.mouseNew.leftMouseButton = false;
-                if (btn->button == Button2) core.Input.mouseNew.middleMouseButton = false;
-                if (btn->button == Button3) core.Input.mouseNew.rightMouseButton = false;
+                if (btn->button == Button1) gi_SetMouseButton(GSGL_LMB, false);
+                if (btn->button == Button2) gi_SetMouseButton(GSGL_MMB, false);
+                if (btn->button == Button3) gi_SetMouseButton(GSGL_RMB, false);
                 break;
             }
 
-            // causes performance problems
-            /*case MotionNotify: {
+            // pointer position. all of them get drained at once now, so this is cheap
+            case MotionNotify: {
                 XPointerMovedEvent* pointer = (XPointerMovedEvent*)&event;
                 core.Input.mouseNew.mouseX = pointer->x;
                 core.Input.mouseNew.mouseY = pointer->y;
                 break;
-            }*/
+            }
+            case EnterNotify:
+            case LeaveNotify: {
+                XCrossingEvent* crossing = (XCrossingEvent*)&event;
+                core.Input.mouseNew.mouseX = crossing->x;
+                core.Input.mouseNew.mouseY = crossing->y;
+                break;
+            }
 
             // Used for handling closing properly
             case ClientMessage: {
@@ -576,8 +835,39 @@ void gsgl_PollEvents() {
             }
         }
     }
+
+    return redraw;
+    #endif
+}
+
+int gsgl_GetEventFd() {
+    #ifdef _WIN32
+    return -1;
+    #else
+    if (core.Graphics.headless == true || platformCore.destroyed == true || platformCore.display == NULL) return -1;
+    return ConnectionNumber(platformCore.display);
+    #endif
+}
+bool gsgl_HasPendingEvents() {
+    if (core.Input.injectedCount > 0) return true;
+
+    #ifdef _WIN32
+    return false;
+    #else
+    if (core.Graphics.headless == true || platformCore.destroyed == true || platformCore.display == NULL) return false;
+
+    // xlib might have read events off the socket already (while waiting on MIT-SHM for example), those won't wake up a poll on the fd
+    return XEventsQueued(platformCore.display, QueuedAlready) > 0;
     #endif
 }
+bool gsgl_IsInputHeld() {
+    if (core.Input.mouseNew.leftMouseButton || core.Input.mouseNew.middleMouseButton || core.Input.mouseNew.rightMouseButton) return true;
+
+    for (int i = 0; i < KEYBOARD_KEYS; i++) {
+        if (core.Input.keysNew[i] == true) return true;
+    }
+    return false;
+}
 
 bool gsgl_ShouldClose() {
     return core.Window.closing;
@@ -585,12 +875,21 @@ bool gsgl_ShouldClose() {
 
 void gsgl_CloseWindow() {
     core.Window.closing = true;
+    gi_TilesStop();
+    gi_GlyphWorkersStop();
+
+    if (core.Graphics.headless == true) return;
 
     #ifdef _WIN32
     PostQuitMessage(0);
     #else
     if (platformCore.destroyed == false) {
         platformCore.destroyed = true;
+        #ifdef GSGL_XSHM
+        for (int i = 0; i < core.Graphics.bufferCount; i++) {
+            if (platformCore.Graphics.Shm.active[i] == true) gi_ShmDestroyImage(i, false);
+        }
+        #endif
         if (platformCore.window != NULL && platformCore.display != NULL) XDestroyWindow(platformCore.display, platformCore.window);
         if (platformCore.display != NULL) XCloseDisplay(platformCore.display);
     }
@@ -632,6 +931,12 @@ bool gsgl_IsWindowVisible() {
 void gsgl_Draw() {
     if (gsgl_IsWindowVisible()) return;
 
+    // nowhere to send it, gsgl_SaveFramePPM reads the on-screen buffer directly
+    if (core.Graphics.headless == true) {
+        core.Graphics.Damage.present.count = 0;
+        return;
+    }
+
     #ifdef _WIN32
     BITMAPINFO bmi = {0};
     bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
@@ -645,30 +950,49 @@ void gsgl_Draw() {
     StretchDIBits(hdc, 0, 0, core.Window.width, core.Window.height, 0, 0, core.Window.width, core.Window.height, core.Graphics.buffer2, &bmi, DIB_RGB_COLORS, SRCCOPY);
     ReleaseDC(platformCore.Window.handle, hdc);
     #else
+    int front = core.Graphics.frontBuffer;
+    XImage* image = platformCore.Graphics.images[front];
     if (
-        platformCore.Graphics.image != NULL && platformCore.Graphics.context && 
-        platformCore.Graphics.image->width == core.Window.width && platformCore.Graphics.image->height == core.Window.height
+        image != NULL && platformCore.Graphics.context && 
+        image->width == core.Window.width && image->height == core.Window.height
     ) {
-        XPutImage(
-            platformCore.display, platformCore.window, 
-            platformCore.Graphics.context, platformCore.Graphics.image, 
-            0, 0, 0, 0, core.Window.width, core.Window.height
-        );
+        // only send what actually changed
+        for (int i = 0; i < core.Graphics.Damage.present.count; i++) {
+            Recti rect = core.Graphics.Damage.present.rects[i];
+
+            #ifdef GSGL_XSHM
+            if (platformCore.Graphics.Shm.active[front] == true) {
+                // only ask for a completion event on the last one, that's the one we wait for
+                bool last = i == core.Graphics.Damage.present.count - 1;
+                XShmPutImage(
+                    platformCore.display, platformCore.window, 
+                    platformCore.Graphics.context, image, 
+                    rect.x, rect.y, rect.x, rect.y, rect.width, rect.height, last ? True : False
+                );
+                if (last) platformCore.Graphics.Shm.pending[front] = true;
+                continue;
+            }
+            #endif
+
+            XPutImage(
+                platformCore.display, platformCore.window, 
+                platformCore.Graphics.context, image, 
+                rect.x, rect.y, rect.x, rect.y, rect.width, rect.height
+            );
+        }
+        XFlush(platformCore.display);
     }
     #endif
+
+    core.Graphics.Damage.present.count = 0;
 }
 void gsgl_SwapBuffers() {
     gsgl_WindowReady();
 
-    int start = core.Graphics.WriteBox.startX * core.Graphics.WriteBox.startY;
-    int end = core.Graphics.WriteBox.endX * core.Graphics.WriteBox.endY;
-
-    for (int i = start; i < end; i++) {
-        core.Graphics.buffer2[i] = core.Graphics.buffer1[i];
-        core.Graphics.buffer1[i] = core.Graphics.swapBufferClear;
-    }
-
-    gsgl_WriteBoxReset();
+    gi_TilesFlush(core.Graphics.buffer1, core.Graphics.swapBufferClear, core.Graphics.bufferCount);
+    gi_FlipBuffers();
+    gi_PrepareBackBuffer();
+    gi_TextEndFrame();
 
     // Update cursor
     if (core.Input.cursorChanged == true && !gsgl_IsWindowVisible()) {
@@ -722,11 +1046,22 @@ void gsgl_BufferAccess(int buffer, int index, uint32_t color) {
         }
     }
 
-    gsgl_WriteBoxUpdate(x, y);
+    if (buffer == 1) gi_DamageAdd(&core.Graphics.Damage.current, {x, y, 1, 1});
+    else if (buffer == 2) gi_DamageAdd(&core.Graphics.Damage.present, {x, y, 1, 1});
 
-    if (buffer == 1) {
+    if (buffer == 1 && gi_TilesActive()) {
+        // has to stay in order with everything else that got recorded
+        gi_TilesFill({x, y, 1, 1}, color);
+    } else if (buffer == 1) {
         core.Graphics.buffer1[index] = gsgl_HandleAlpha(core.Graphics.buffer1[index], color);
     } else if (buffer == 2) {
+        #ifdef GSGL_XSHM
+        gi_ShmWaitForPresent(core.Graphics.frontBuffer);
+        #endif
+        // the next flip has to compare against this pixel too
+        gi_DamageAdd(&core.Graphics.buffers[core.Graphics.frontBuffer].drawn, {x, y, 1, 1});
+        gi_DamageAdd(&core.Graphics.Damage.previous, {x, y, 1, 1});
+        gi_TilesInvalidate();
         core.Graphics.buffer2[index] = gsgl_HandleAlpha(core.Graphics.buffer2[index], color);
     }
 }
@@ -742,39 +1077,80 @@ void gsgl_Pixel(int x, int y, Color col) {
     gsgl_BufferAccess(1, y * core.Window.width + x, color);
 }
 void gsgl_Rect(int x, int y, int width, int height, Color col) {
+    gi_FillRect(x, y, x + width, y + height, gsgl_PackColor(col));
+}
+void gsgl_RectOutline(int x, int y, int width, int height, int thickness, Color col) {
     uint32_t color = gsgl_PackColor(col);
 
-    for (int j = y; j < y + height; j++) {
-        if (j < 0) continue;
-        if (j >= core.Window.height) continue;
-        for (int i = x; i < x + width; i++) {
-            if (i < 0) continue;
-            if (i >= core.Window.width) continue;
-            gsgl_BufferAccess(1, j * core.Window.width + i, color);
-        }
+    if (width <= 0 || height <= 0 || thickness <= 0) return;
+    int tx = std::min(thickness, width);
+    int ty = std::min(thickness, height);
+
+    // split it into 4 bands that never overlap, so translucent outlines don't get blended twice
+    gi_FillRect(x, y, x + width, y + ty, color); // top
+    gi_FillRect(x, std::max(y + height - ty, y + ty), x + width, y + height, color); // bottom
+    if (height - ty * 2 > 0) {
+        gi_FillRect(x, y + ty, x + tx, y + height - ty, color); // left
+        gi_FillRect(std::max(x + width - tx, x + tx), y + ty, x + width, y + height - ty, color); // right
     }
 }
-void gsgl_RectOutline(int x, int y, int width, int height, int thickness, Color col) {
-    uint32_t color = gsgl_PackColor(col);
+void gsgl_DrawImage(const uint32_t* pixels, int x, int y, int width, int height) {
+    if (gsgl_IsWindowVisible()) return; // optimization
+    if (pixels == NULL) return;
+
+    int x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+    if (!gi_ClipRect(&x0, &y0, &x1, &y1)) return;
+
+    if (gi_TilesActive()) {
+        gi_TilesImage({x0, y0, x1 - x0, y1 - y0}, pixels + (y0 - y) * width + (x0 - x), width);
+        return;
+    }
+
+    gi_DamageAdd(&core.Graphics.Damage.current, {x0, y0, x1 - x0, y1 - y0});
+
+    for (int j = y0; j < y1; j++) {
+        uint32_t* row = core.Graphics.buffer1 + j * core.Window.width + x0;
+        gsgl_BlendSpan(row, pixels + (j - y) * width + (x0 - x), x1 - x0);
+    }
+}
+
+void gsgl_DrawMask(const uint8_t* mask, int stride, int x, int y, int width, int height, Color col) {
+    gi_DrawMask(mask, stride, x, y, width, height, col, 0);
+}
+// key is 0, or something that's the same every time mask has the same pixels in it (glyphs)
+void gi_DrawMask(const uint8_t* mask, int stride, int x, int y, int width, int height, Color col, uint64_t key) {
+    if (gsgl_IsWindowVisible()) return; // optimization
+    if (mask == NULL || col.a == 0) return;
+
+    // clipped once for the whole thing, the rows don't have to check anything
+    int x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+    if (!gi_ClipRect(&x0, &y0, &x1, &y1)) return;
 
-    for (int j = y; j < y + height; j++) {
-        if (j < 0) continue;
-        if (j >= core.Window.height) continue;
-        for (int i = x; i < x + width; i++) {
-            if (i < 0) continue;
-            if (i >= core.Window.width) continue;
+    uint32_t color = gsgl_PackColor(col);
+    const uint8_t* start = mask + (y0 - y) * stride + (x0 - x);
 
-            if ((j-y < thickness || j-y >= height-thickness) || (i-x < thickness || i-x >= width-thickness))
-                gsgl_BufferAccess(1, j * core.Window.width + i, color);
+    if (gi_TilesActive()) {
+        if (key != 0) {
+            // clipping changes which part of it gets drawn
+            key = (key * 0x100000001B3ULL + (uint64_t)(x0 - x)) * 0x100000001B3ULL + (uint64_t)(y0 - y);
+            gi_TilesMaskKeyed({x0, y0, x1 - x0, y1 - y0}, start, stride, color, key);
+        } else {
+            gi_TilesMask({x0, y0, x1 - x0, y1 - y0}, start, stride, color);
         }
+        return;
+    }
+
+    gi_DamageAdd(&core.Graphics.Damage.current, {x0, y0, x1 - x0, y1 - y0});
+
+    for (int j = y0; j < y1; j++) {
+        uint32_t* row = core.Graphics.buffer1 + j * core.Window.width + x0;
+        gsgl_BlendMaskSpan(row, start + (j - y0) * stride, color, x1 - x0);
     }
 }
 
 void gsgl_Clear(Color color) {
-    if (core.Graphics.swapBufferClear != gsgl_PackColor(color)) {
-        core.Graphics.swapBufferClear = gsgl_PackColor(color);
-        gsgl_WriteBoxSet(0, 0, core.Window.width, core.Window.height);
-    }
+    // each framebuffer notices the new color itself when it comes back around
+    core.Graphics.swapBufferClear = gsgl_PackColor(color);
 }
 
 // Scissors
@@ -789,36 +1165,24 @@ void gsgl_ScissorsStop() {
     core.Graphics.Scissors.active = false;
 }
 
-// Write box
-void gsgl_WriteBoxReset() {
-    core.Graphics.WriteBox.startX = 0;
-    core.Graphics.WriteBox.startY = 0;
-    core.Graphics.WriteBox.endX = 0;
-    core.Graphics.WriteBox.endY = 0;
-}
-void gsgl_WriteBoxSet(int x, int y, int width, int height) {
-    core.Graphics.WriteBox.startX = x;
-    core.Graphics.WriteBox.startY = y;
-    core.Graphics.WriteBox.endX = x + width;
-    core.Graphics.WriteBox.endY = y + height;
+// Damage
+void gsgl_DamageReset() {
+    core.Graphics.Damage.current.count = 0;
 }
-void gsgl_WriteBoxUpdate(int x, int y) {
-    if (x < core.Graphics.WriteBox.startX) core.Graphics.WriteBox.startX = x;
-    if (x > core.Graphics.WriteBox.endX) core.Graphics.WriteBox.endX = x;
-
-    if (y < core.Graphics.WriteBox.startY) core.Graphics.WriteBox.startY = y;
-    if (y > core.Graphics.WriteBox.endY) core.Graphics.WriteBox.endY = y;
+void gsgl_DamageRect(int x, int y, int width, int height) {
+    int x0 = std::max(x, 0), y0 = std::max(y, 0);
+    int x1 = std::min(x + width, core.Window.width), y1 = std::min(y + height, core.Window.height);
+    if (x0 >= x1 || y0 >= y1) return;
 
-    // cappings
-    if (core.Graphics.WriteBox.startX < 0) core.Graphics.WriteBox.startX = 0;
-    if (core.Graphics.WriteBox.startY < 0) core.Graphics.WriteBox.startY = 0;
-    if (core.Graphics.WriteBox.startX >= core.Window.width) core.Graphics.WriteBox.startX = core.Window.width;
-    if (core.Graphics.WriteBox.startY >= core.Window.height) core.Graphics.WriteBox.startY = core.Window.height;
-
-    if (core.Graphics.WriteBox.endX < 0) core.Graphics.WriteBox.endX = 0;
-    if (core.Graphics.WriteBox.endY < 0) core.Graphics.WriteBox.endY = 0;
-    if (core.Graphics.WriteBox.endX >= core.Window.width) core.Graphics.WriteBox.endX = core.Window.width;
-    if (core.Graphics.WriteBox.endY >= core.Window.height) core.Graphics.WriteBox.endY = core.Window.height;
+    gi_DamageAdd(&core.Graphics.Damage.current, {x0, y0, x1 - x0, y1 - y0});
+}
+void gsgl_DamageFull() {
+    core.Graphics.Damage.current.count = 0;
+    gi_DamageAdd(&core.Graphics.Damage.current, {0, 0, core.Window.width, core.Window.height});
+}
+void gsgl_DamagePresentFull() {
+    core.Graphics.Damage.present.count = 0;
+    gi_DamageAdd(&core.Graphics.Damage.present, {0, 0, core.Window.width, core.Window.height});
 }
 
 // Utility functions
@@ -826,41 +1190,12 @@ float gsgl_Lerp(float start, float end, float amount) {
     float result = start + amount * (end - start);
     return result;
 }
-#pragma runtime_checks("", off)
 uint32_t gsgl_HandleAlpha(uint32_t a, uint32_t b) {
-    // TODO: consider the first alpha maybe
-    float a1 = (float)((a >> 24) & 0xFF);
-    float a2 = (float)((b >> 24) & 0xFF);
-
-    // do a quick check if we actually need to do this.
-    if (a2 > 0 && a2 < 255) {
-        Color col1 = gsgl_UnpackColor(a);
-        Color col2 = gsgl_UnpackColor(b);
-
-        float r1 = (float)col1.r;
-        float g1 = (float)col1.g;
-        float b1 = (float)col1.b;
-
-        float r2 = (float)col2.r;
-        float g2 = (float)col2.g;
-        float b2 = (float)col2.b;
-
-        float amount = a2/255;
-        float r3 = gsgl_Lerp(r1, r2, amount);
-        float g3 = gsgl_Lerp(g1, g2, amount);
-        float b3 = gsgl_Lerp(b1, b2, amount);
-        float a3 = a2; // stays as it is. might change. just future-proofing
-
-        return gsgl_PackColor({ (unsigned char)r3, (unsigned char)g3, (unsigned char)b3, (unsigned char)a3 });
-    } else if (a2 >= 255) {
-        return b;
-    } else if (a2 <= 0) {
-        return a;
-    } else {
-        return a;
-    }
+    // goes through the same kernels as everything else, so single pixels match the spans
+    uint32_t result = a;
+    gsgl_BlendSpan(&result, &b, 1);
+    return result;
 }
-#pragma runtime_checks("", restore)
 Color gsgl_UnpackColor(uint32_t col) {
     Color color = { 0 };
 
@@ -1003,26 +1338,335 @@ void gi_ResizeWindow(int width, int height) {
 }
 void gi_InitBuffers() {
     if (core.Graphics.software == true) {
-        if (core.Graphics.buffersInited == true) free(core.Graphics.buffer1);
-        core.Graphics.buffer1 = (uint32_t*) malloc(core.Window.width * core.Window.height * sizeof(uint32_t));
-        memset(core.Graphics.buffer1, 0, core.Window.width * core.Window.height * sizeof(uint32_t));
-
-        if (core.Graphics.buffersInited == true) free(core.Graphics.buffer2);
-        core.Graphics.buffer2 = (uint32_t*) malloc(core.Window.width * core.Window.height * sizeof(uint32_t));
-        memset(core.Graphics.buffer2, 0, core.Window.width * core.Window.height * sizeof(uint32_t));
-
-        #ifndef _WIN32
-        platformCore.Graphics.image = XCreateImage(
-            platformCore.display, platformCore.Graphics.vinfo.visual, platformCore.Graphics.depth, ZPixmap, 
-            0, (char*)core.Graphics.buffer2, core.Window.width, core.Window.height, 8, core.Window.width*4
-        );
-        #endif
+        if (core.Graphics.bufferCount < 2) core.Graphics.bufferCount = 2;
+        size_t size = core.Window.width * core.Window.height * sizeof(uint32_t);
+
+        // whatever got recorded was for the old size
+        gi_TilesReset();
+        gi_TilesInvalidate();
+
+        for (int i = 0; i < core.Graphics.bufferCount; i++) {
+            gi_Framebuffer* buffer = &core.Graphics.buffers[i];
+
+            // the pixels belong to the image on X11, so that goes first
+            #ifndef _WIN32
+            #ifdef GSGL_XSHM
+            if (platformCore.Graphics.Shm.active[i] == true) gi_ShmDestroyImage(i, true);
+            #endif
+
+            if (platformCore.Graphics.images[i] != NULL) {
+                platformCore.Graphics.images[i]->data = NULL; // we free it ourselves
+                XDestroyImage(platformCore.Graphics.images[i]);
+                platformCore.Graphics.images[i] = NULL;
+            }
+            #endif
+
+            if (buffer->pixels != NULL) free(buffer->pixels);
+            buffer->pixels = NULL;
+
+            bool shared = false;
+            #ifdef GSGL_XSHM
+            if (platformCore.Graphics.Shm.available == true) shared = gi_ShmCreateImage(i);
+            #endif
+
+            if (shared == false) {
+                buffer->pixels = (uint32_t*) malloc(size);
+
+                #ifndef _WIN32
+                if (core.Graphics.headless == false) platformCore.Graphics.images[i] = XCreateImage(
+                    platformCore.display, platformCore.Graphics.vinfo.visual, platformCore.Graphics.depth, ZPixmap, 
+                    0, (char*)buffer->pixels, core.Window.width, core.Window.height, 8, core.Window.width*4
+                );
+                #endif
+            }
+            memset(buffer->pixels, 0, size);
+
+            buffer->drawn.count = 0;
+            buffer->clearColor = 0;
+        }
+
+        core.Graphics.backBuffer = 0;
+        core.Graphics.frontBuffer = core.Graphics.bufferCount - 1;
+        core.Graphics.buffer1 = core.Graphics.buffers[core.Graphics.backBuffer].pixels;
+        core.Graphics.buffer2 = core.Graphics.buffers[core.Graphics.frontBuffer].pixels;
+
+        // old rects might not even be on screen anymore
+        core.Graphics.Damage.previous.count = 0;
+        gsgl_DamageFull();
+        gsgl_DamagePresentFull();
 
         if (core.Graphics.buffersInited == false)
             core.Graphics.buffersInited = true;
     }
 }
 
+// Buffer flipping
+// the off-screen buffer becomes the on-screen one just by swapping pointers, nothing gets copied.
+void gi_FlipBuffers() {
+    // what's in the window right now is the old on-screen buffer, so we have to find what's different from it.
+    // that can only be something drawn this frame or the frame before
+    gi_DamageList changed = core.Graphics.Damage.previous;
+    for (int i = 0; i < core.Graphics.Damage.current.count; i++) {
+        gi_DamageAdd(&changed, core.Graphics.Damage.current.rects[i]);
+    }
+    for (int i = 0; i < changed.count; i++) {
+        gi_DamageCompareRect(changed.rects[i]);
+    }
+
+    gi_Framebuffer* back = &core.Graphics.buffers[core.Graphics.backBuffer];
+    for (int i = 0; i < core.Graphics.Damage.current.count; i++) {
+        gi_DamageAdd(&back->drawn, core.Graphics.Damage.current.rects[i]);
+    }
+
+    core.Graphics.frontBuffer = core.Graphics.backBuffer;
+    core.Graphics.backBuffer = (core.Graphics.backBuffer + 1) % core.Graphics.bufferCount;
+    core.Graphics.buffer1 = core.Graphics.buffers[core.Graphics.backBuffer].pixels;
+    core.Graphics.buffer2 = core.Graphics.buffers[core.Graphics.frontBuffer].pixels;
+
+    core.Graphics.Damage.previous = core.Graphics.Damage.current;
+    gsgl_DamageReset();
+}
+void gi_PrepareBackBuffer() {
+    #ifdef GSGL_XSHM
+    // don't draw over a buffer the server is still reading
+    gi_ShmWaitForPresent(core.Graphics.backBuffer);
+    #endif
+
+    // clear whatever is left over from the last time this buffer was drawn into
+    gi_Framebuffer* back = &core.Graphics.buffers[core.Graphics.backBuffer];
+    if (back->clearColor != core.Graphics.swapBufferClear) {
+        gi_DamageClearRect(back->pixels, {0, 0, core.Window.width, core.Window.height}, core.Graphics.swapBufferClear);
+        back->clearColor = core.Graphics.swapBufferClear;
+
+        // the whole screen changes color, so it all has to be compared next time
+        gsgl_DamageFull();
+    } else if (gi_TilesRetained() == false) {
+        for (int i = 0; i < back->drawn.count; i++) {
+            gi_DamageClearRect(back->pixels, back->drawn.rects[i], back->clearColor);
+        }
+    }
+    // in retained mode the tiles clear themselves when they get redrawn
+    back->drawn.count = 0;
+}
+
+#ifdef GSGL_XSHM
+// MIT-SHM
+static bool shmAttachFailed = false;
+static int gi_ShmErrorHandler(Display*, XErrorEvent*) {
+    // XShmAttach fails on remote displays, which would normally just kill the app
+    shmAttachFailed = true;
+    return 0;
+}
+static Bool gi_IsShmCompletion(Display*, XEvent* event, XPointer) {
+    return event->type == platformCore.Graphics.Shm.completionType ? True : False;
+}
+
+bool gi_ShmCreateImage(int buffer) {
+    XShmSegmentInfo* info = &platformCore.Graphics.Shm.info[buffer];
+
+    XImage* image = XShmCreateImage(
+        platformCore.display, platformCore.Graphics.vinfo.visual, platformCore.Graphics.depth, ZPixmap, 
+        NULL, info, core.Window.width, core.Window.height
+    );
+    if (image == NULL) return false;
+
+    // we index the buffer as width*4 bytes per row everywhere else
+    if (image->bytes_per_line != core.Window.width * 4) {
+        XDestroyImage(image);
+        return false;
+    }
+
+    info->shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+    if (info->shmid < 0) {
+        XDestroyImage(image);
+        return false;
+    }
+
+    info->shmaddr = image->data = (char*)shmat(info->shmid, NULL, 0);
+    if (info->shmaddr == (char*)-1) {
+        shmctl(info->shmid, IPC_RMID, NULL);
+        image->data = NULL;
+        XDestroyImage(image);
+        return false;
+    }
+    info->readOnly = False;
+
+    shmAttachFailed = false;
+    XErrorHandler oldHandler = XSetErrorHandler(gi_ShmErrorHandler);
+    XShmAttach(platformCore.display, info);
+    XSync(platformCore.display, False);
+    XSetErrorHandler(oldHandler);
+
+    // the segment goes away by itself once both of us detach from it
+    shmctl(info->shmid, IPC_RMID, NULL);
+
+    if (shmAttachFailed == true) {
+        Logger_log(LOGGER_WARNING, "GRAPHICS: Could not attach MIT-SHM segment, falling back to XPutImage");
+        platformCore.Graphics.Shm.available = false;
+
+        shmdt(info->shmaddr);
+        image->data = NULL;
+        XDestroyImage(image);
+        return false;
+    }
+
+    platformCore.Graphics.images[buffer] = image;
+    platformCore.Graphics.Shm.active[buffer] = true;
+    platformCore.Graphics.Shm.pending[buffer] = false;
+    core.Graphics.buffers[buffer].pixels = (uint32_t*)image->data;
+
+    return true;
+}
+void gi_ShmDestroyImage(int buffer, bool wait) {
+    if (wait == true) gi_ShmWaitForPresent(buffer);
+
+    XShmDetach(platformCore.display, &platformCore.Graphics.Shm.info[buffer]);
+    XSync(platformCore.display, False);
+    shmdt(platformCore.Graphics.Shm.info[buffer].shmaddr);
+
+    platformCore.Graphics.images[buffer]->data = NULL;
+    XDestroyImage(platformCore.Graphics.images[buffer]);
+    platformCore.Graphics.images[buffer] = NULL;
+
+    core.Graphics.buffers[buffer].pixels = NULL;
+    platformCore.Graphics.Shm.active[buffer] = false;
+    platformCore.Graphics.Shm.pending[buffer] = false;
+}
+void gi_ShmWaitForPresent(int buffer) {
+    // pulls only completion events out of the queue, everything else stays for PollEvents
+    while (platformCore.Graphics.Shm.pending[buffer] == true) {
+        XEvent event;
+        XIfEvent(platformCore.display, &event, gi_IsShmCompletion, NULL);
+
+        XShmCompletionEvent* completion = (XShmCompletionEvent*)&event;
+        for (int i = 0; i < core.Graphics.bufferCount; i++) {
+            if (platformCore.Graphics.Shm.active[i] == true && platformCore.Graphics.Shm.info[i].shmseg == completion->shmseg) {
+                platformCore.Graphics.Shm.pending[i] = false;
+            }
+        }
+    }
+}
+#endif
+
+// Damage lists
+static inline int gi_RectArea(Recti rect) {
+    return rect.width * rect.height;
+}
+static inline Recti gi_RectUnion(Recti a, Recti b) {
+    int x0 = std::min(a.x, b.x), y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.width, b.x + b.width), y1 = std::max(a.y + a.height, b.y + b.height);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+void gi_DamageAdd(gi_DamageList* list, Recti rect) {
+    if (rect.width <= 0 || rect.height <= 0) return;
+
+    // keep merging with whatever's close enough. the merged rect might now be close to something else, so start over every time
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < list->count; i++) {
+            Recti other = list->rects[i];
+            Recti both = gi_RectUnion(other, rect);
+
+            if (gi_RectArea(both) <= gi_RectArea(other) + gi_RectArea(rect) + GSGL_DAMAGE_MERGE_SLACK) {
+                if (gi_RectArea(both) == gi_RectArea(other)) return; // already covered
+
+                rect = both;
+                list->rects[i] = list->rects[--list->count];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (list->count < GSGL_DAMAGE_RECTS) {
+        list->rects[list->count++] = rect;
+        return;
+    }
+
+    // no room left. merge into whichever rect grows the least
+    int best = 0;
+    int bestGrowth = -1;
+    for (int i = 0; i < list->count; i++) {
+        int growth = gi_RectArea(gi_RectUnion(list->rects[i], rect)) - gi_RectArea(list->rects[i]);
+        if (bestGrowth < 0 || growth < bestGrowth) {
+            best = i;
+            bestGrowth = growth;
+        }
+    }
+
+    Recti both = gi_RectUnion(list->rects[best], rect);
+    list->rects[best] = list->rects[--list->count];
+    gi_DamageAdd(list, both);
+}
+void gi_DamageCompareRect(Recti rect) {
+    // rows that came out the same as last frame don't need to go anywhere
+    int first = -1;
+    int last = -1;
+    size_t rowBytes = rect.width * sizeof(uint32_t);
+
+    for (int j = rect.y; j < rect.y + rect.height; j++) {
+        uint32_t* back = core.Graphics.buffer1 + j * core.Window.width + rect.x;
+        uint32_t* front = core.Graphics.buffer2 + j * core.Window.width + rect.x;
+
+        if (memcmp(back, front, rowBytes) != 0) {
+            if (first == -1) first = j;
+            last = j;
+        }
+    }
+
+    if (first != -1) gi_DamageAdd(&core.Graphics.Damage.present, {rect.x, first, rect.width, last - first + 1});
+}
+void gi_DamageClearRect(uint32_t* buffer, Recti rect, uint32_t color) {
+    for (int j = rect.y; j < rect.y + rect.height; j++) {
+        uint32_t* row = buffer + j * core.Window.width + rect.x;
+        std::fill(row, row + rect.width, color);
+    }
+}
+
+// Span filling
+// instead of going through BufferAccess for every single pixel, we clip the rect once
+// and then fill whole rows at a time.
+bool gi_ClipRect(int* x0, int* y0, int* x1, int* y1) {
+    if (*x0 < 0) *x0 = 0;
+    if (*y0 < 0) *y0 = 0;
+    if (*x1 > core.Window.width) *x1 = core.Window.width;
+    if (*y1 > core.Window.height) *y1 = core.Window.height;
+
+    if (core.Graphics.Scissors.active == true) {
+        if (*x0 < core.Graphics.Scissors.startX) *x0 = core.Graphics.Scissors.startX;
+        if (*y0 < core.Graphics.Scissors.startY) *y0 = core.Graphics.Scissors.startY;
+        if (*x1 > core.Graphics.Scissors.endX) *x1 = core.Graphics.Scissors.endX;
+        if (*y1 > core.Graphics.Scissors.endY) *y1 = core.Graphics.Scissors.endY;
+    }
+
+    return *x0 < *x1 && *y0 < *y1;
+}
+void gi_FillRect(int x0, int y0, int x1, int y1, uint32_t color) {
+    if (gsgl_IsWindowVisible()) return; // optimization
+    if (!gi_ClipRect(&x0, &y0, &x1, &y1)) return;
+
+    uint32_t alpha = (color >> 24) & 0xFF;
+    if (alpha == 0) return; // nothing would change anyway
+
+    if (gi_TilesActive()) {
+        gi_TilesFill({x0, y0, x1 - x0, y1 - y0}, color);
+        return;
+    }
+
+    gi_DamageAdd(&core.Graphics.Damage.current, {x0, y0, x1 - x0, y1 - y0});
+
+    int count = x1 - x0;
+    for (int j = y0; j < y1; j++) {
+        uint32_t* row = core.Graphics.buffer1 + j * core.Window.width + x0;
+        if (alpha == 255) {
+            std::fill(row, row + count, color);
+        } else {
+            gsgl_BlendSpanColor(row, color, count);
+        }
+    }
+}
+
 #ifdef _WIN32
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     switch (uMsg) {
@@ -1057,29 +1701,34 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         // input
         // mouse
         case WM_LBUTTONDOWN: {
-            core.Input.mouseNew.leftMouseButton = true;
+            gi_SetMouseButton(GSGL_LMB, true);
             return 0;
         }
         case WM_LBUTTONUP: {
-            core.Input.mouseNew.leftMouseButton = false;
+            gi_SetMouseButton(GSGL_LMB, false);
             return 0;
         }
 
         case WM_MBUTTONDOWN: {
-            core.Input.mouseNew.middleMouseButton = true;
+            gi_SetMouseButton(GSGL_MMB, true);
             return 0;
         }
         case WM_MBUTTONUP: {
-            core.Input.mouseNew.middleMouseButton = false;
+            gi_SetMouseButton(GSGL_MMB, false);
             return 0;
         }
 
         case WM_RBUTTONDOWN: {
-            core.Input.mouseNew.rightMouseButton = true;
+            gi_SetMouseButton(GSGL_RMB, true);
             return 0;
         }
         case WM_RBUTTONUP: {
-            core.Input.mouseNew.rightMouseButton = false;
+            gi_SetMouseButton(GSGL_RMB, false);
+            return 0;
+        }
+
+        case WM_MOUSEWHEEL: {
+            core.Input.mouseNew.mouseScrollWheel += GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
             return 0;
         }
 
@@ -1097,12 +1746,12 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             // whenever i want to add any more keys into the big enum thing i just use this
             //printf("key down: %i\n", int(wParam));
 
-            core.Input.keysNew[(int)wParam] = true;
+            gi_SetKey((int)wParam, true);
             return 0;
         }
         case WM_SYSKEYUP:
         case WM_KEYUP: {
-            core.Input.keysNew[(int)wParam] = false;
+            gi_SetKey((int)wParam, false);
             core.Input.keysRepeat[(int)wParam] = 0;
             return 0;
         }
@@ -1168,10 +1817,13 @@ double gsgl_GetTime() {
 	QueryPerformanceCounter(&counter);
     return (double) (counter.QuadPart / (double) frequency.QuadPart);
     #else
+    // seconds since gsgl_InitTimer, same unit as everything else in Time
     struct timespec now;
     if (clock_gettime(CLOCK_MONOTONIC, &now) == 0) { // Success
-        return (double)now.tv_sec*1000000000LLU + (double)now.tv_nsec;
+        unsigned long long int nanoSeconds = (unsigned long long int)now.tv_sec*1000000000LLU + (unsigned long long int)now.tv_nsec;
+        return (double)(nanoSeconds - core.Time.base) * 1e-9;
     }
+    return 0.0;
     #endif
 }
 
@@ -1222,13 +1874,7 @@ float gsgl_GetFrameTime() {
 // input
 // mouse
 Vector2i gsgl_GetMousePosition() {
-    #ifndef _WIN32
-    Window child_win, root_win;
-    int rootX, rootY;
-    unsigned int mask;
-    XQueryPointer(platformCore.display, platformCore.window, &child_win, &root_win, &rootX, &rootY, &core.Input.mouseNew.mouseX, &core.Input.mouseNew.mouseY, &mask);
-    #endif
-
+    // on X11 this is kept up to date by MotionNotify, asking the server every time was a round trip per call
     return {core.Input.mouseNew.mouseX, core.Input.mouseNew.mouseY};
 }
 
@@ -1243,16 +1889,16 @@ bool gsgl_IsMouseButtonUp(GSGL_MouseButton button) {
 }
 
 bool gsgl_IsMouseButtonPressed(GSGL_MouseButton button) {
-    if (button == GSGL_LMB) if (core.Input.mouseNew.leftMouseButton == true && core.Input.mouseOld.leftMouseButton == false) return true;
-    else if (button == GSGL_RMB) if (core.Input.mouseNew.rightMouseButton == true && core.Input.mouseOld.rightMouseButton == false) return true;
-    else if (button == GSGL_MMB) if (core.Input.mouseNew.middleMouseButton == true && core.Input.mouseOld.middleMouseButton == false) return true;
-    return false;
+    if (button < 0 || button >= MOUSE_BUTTONS) return false;
+    return core.Input.buttonsPressedFrame[button];
 }
 bool gsgl_IsMouseButtonReleased(GSGL_MouseButton button) {
-    if (button == GSGL_LMB) if (core.Input.mouseNew.leftMouseButton == false && core.Input.mouseOld.leftMouseButton == true) return true;
-    else if (button == GSGL_RMB) if (core.Input.mouseNew.rightMouseButton == false && core.Input.mouseOld.rightMouseButton == true) return true;
-    else if (button == GSGL_MMB) if (core.Input.mouseNew.middleMouseButton == false && core.Input.mouseOld.middleMouseButton == true) return true;
-    return false;
+    if (button < 0 || button >= MOUSE_BUTTONS) return false;
+    return core.Input.buttonsReleasedFrame[button];
+}
+
+int gsgl_GetMouseWheel() {
+    return core.Input.mouseFrame.mouseScrollWheel;
 }
 
 void gsgl_SetCursor(GSGL_Cursor cursor) {
@@ -1272,24 +1918,20 @@ bool gsgl_IsKeyUp(GSGL_Key key) {
 }
 
 bool gsgl_IsKeyPressed(GSGL_Key key) {
-    if (core.Input.keysNew[key] == true && core.Input.keysOld[key] == false) return true;
-    else return false;
+    return core.Input.keysPressedFrame[key];
 }
 bool gsgl_IsKeyReleased(GSGL_Key key) {
-    if (core.Input.keysNew[key] == false && core.Input.keysOld[key] == true) return true;
-    else return false;
+    return core.Input.keysReleasedFrame[key];
 }
 
 bool gsgl_IsKeyRepeat(GSGL_Key key) {
     // this may or may not be the best idea.
     // handle the repeating logic here
 
-    if (core.Input.keysNew[key] == true && core.Input.keysOld[key] == false) {
+    // a tap counts once even if the key is already up again
+    if (core.Input.keysPressedFrame[key] == true) {
         core.Input.keysRepeat[key] = core.Input.repeatDelay;
         return true;
-    } else if (core.Input.keysNew[key] == false && core.Input.keysOld[key] == true) {
-        core.Input.keysRepeat[key] = 0;
-        return false;
     }
 
     if (core.Input.keysNew[key] == false) {
@@ -1312,6 +1954,119 @@ char gsgl_GetLastChar() {
     return core.Input.lastChar;
 }
 
+// every press and release goes through these, the edges are kept until the next PollEvents
+void gi_SetKey(int key, bool down) {
+    if (key < 0 || key >= KEYBOARD_KEYS) return;
+
+    if (down == true && core.Input.keysNew[key] == false) core.Input.keysPressed[key] = true;
+    if (down == false && core.Input.keysNew[key] == true) core.Input.keysReleased[key] = true;
+    core.Input.keysNew[key] = down;
+}
+void gi_SetMouseButton(GSGL_MouseButton button, bool down) {
+    bool* state = NULL;
+    if (button == GSGL_LMB) state = &core.Input.mouseNew.leftMouseButton;
+    else if (button == GSGL_RMB) state = &core.Input.mouseNew.rightMouseButton;
+    else if (button == GSGL_MMB) state = &core.Input.mouseNew.middleMouseButton;
+    else return;
+
+    if (down == true && *state == false) core.Input.buttonsPressed[button] = true;
+    if (down == false && *state == true) core.Input.buttonsReleased[button] = true;
+    *state = down;
+}
+
+// injected input
+// works with a window too, but mostly meant for headless runs
+void gi_Inject(gi_InjectedEvent event) {
+    if (core.Input.injectedCount >= GSGL_MAX_INJECTED_EVENTS) {
+        Logger_log(LOGGER_WARNING, "GRAPHICS: Too many injected events, dropping one");
+        return;
+    }
+    core.Input.injected[core.Input.injectedCount++] = event;
+}
+void gsgl_InjectKey(GSGL_Key key, bool down) {
+    gi_Inject({GI_INJECT_KEY, (int)key, 0, down});
+}
+void gsgl_InjectMouseButton(GSGL_MouseButton button, bool down) {
+    gi_Inject({GI_INJECT_BUTTON, (int)button, 0, down});
+}
+void gsgl_InjectMouseMove(int x, int y) {
+    gi_Inject({GI_INJECT_MOVE, x, y, false});
+}
+void gsgl_InjectMouseWheel(int notches) {
+    gi_Inject({GI_INJECT_WHEEL, notches, 0, false});
+}
+void gsgl_InjectChar(char character) {
+    gi_Inject({GI_INJECT_CHAR, (int)character, 0, false});
+}
+void gsgl_InjectResize(int width, int height) {
+    gi_Inject({GI_INJECT_RESIZE, width, height, false});
+}
+
+void gi_ApplyInjectedEvents() {
+    for (int i = 0; i < core.Input.injectedCount; i++) {
+        gi_InjectedEvent event = core.Input.injected[i];
+
+        switch (event.type) {
+            case GI_INJECT_KEY: {
+                gi_SetKey(event.a, event.down);
+                break;
+            }
+            case GI_INJECT_BUTTON: {
+                gi_SetMouseButton((GSGL_MouseButton)event.a, event.down);
+                break;
+            }
+            case GI_INJECT_MOVE: {
+                core.Input.mouseNew.mouseX = event.a;
+                core.Input.mouseNew.mouseY = event.b;
+                break;
+            }
+            case GI_INJECT_WHEEL: {
+                core.Input.mouseNew.mouseScrollWheel += event.a;
+                break;
+            }
+            case GI_INJECT_CHAR: {
+                core.Input.lastChar = (char)event.a;
+                break;
+            }
+            case GI_INJECT_RESIZE: {
+                if (event.a > 0 && event.b > 0) gi_ResizeWindow(event.a, event.b);
+                break;
+            }
+        }
+    }
+    core.Input.injectedCount = 0;
+}
+
+// frame dumps
+bool gsgl_SaveFramePPM(const char* fileName) {
+    if (core.Graphics.software == false || core.Graphics.buffer2 == NULL) return false;
+
+    FILE* file = fopen(fileName, "wb");
+    if (file == NULL) {
+        Logger_log(LOGGER_ERROR, "GRAPHICS: Couldn't open %s for writing", fileName);
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", core.Window.width, core.Window.height);
+
+    // one row at a time, alpha doesn't go in a ppm
+    unsigned char* row = (unsigned char*)malloc(core.Window.width * 3);
+    for (int j = 0; j < core.Window.height; j++) {
+        const uint32_t* pixels = core.Graphics.buffer2 + j * core.Window.width;
+        for (int i = 0; i < core.Window.width; i++) {
+            row[i * 3 + 0] = (pixels[i] >> 16) & 0xFF;
+            row[i * 3 + 1] = (pixels[i] >> 8) & 0xFF;
+            row[i * 3 + 2] = pixels[i] & 0xFF;
+        }
+        fwrite(row, 1, core.Window.width * 3, file);
+    }
+    free(row);
+
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
 // clipboard
 const char* gsgl_GetClipboardText() {
     #ifdef _WIN32
@@ -10,10 +10,9 @@
     #define GSGL_API
 #endif
 
+#include <cstddef>
 #include <cstdint>
 
-#include "libs/stb_truetype.h"
-
 // == TYPES
 
 // some types start with GSGL, some dont.
@@ -28,6 +27,13 @@ typedef struct Vector2i {
     int y;
 } Vector2i;
 
+typedef struct Recti {
+    int x;
+    int y;
+    int width;
+    int height;
+} Recti;
+
 typedef struct Color {
     unsigned char r;
     unsigned char g;
@@ -39,13 +45,73 @@ typedef struct GSGL_Texture {
 
 } GSGL_Texture;
 
+// a handle into the font registry, cheap to copy around. see gsgl_LoadFont
 typedef struct GSGL_Font {
-    stbtt_fontinfo font;
-    unsigned char* font_buffer;
-
+    int id;
     bool valid;
 } GSGL_Font;
 
+// glyphs rasterized at build time (see fontbake), so a font's common sizes never get rasterized at runtime
+typedef struct GSGL_BakedGlyph {
+    int glyph;     // glyph index
+    int size;      // pixel size in 1/64ths
+    int phase;     // subpixel offset, in 1/4ths of a pixel
+    float advance; // scaled, not rounded
+    int x0;        // bitmap offset from the pen position
+    int y0;
+    int width;
+    int height;
+    int atlasX;    // where the coverage is in the atlas
+    int atlasY;
+} GSGL_BakedGlyph;
+
+typedef struct GSGL_BakedAtlas {
+    const uint8_t* pixels; // A8
+    int width;
+    int height;
+    const GSGL_BakedGlyph* glyphs;
+    int glyphCount;
+} GSGL_BakedAtlas;
+
+// what gsgl_MeasureText gives back, owned by the measurement cache
+typedef struct GSGL_TextMetrics {
+    const int* advances; // advances[i] is how wide the first i bytes are, so there's length+1 of them
+    int length;
+    int width;
+    int height;
+} GSGL_TextMetrics;
+
+// text that got laid out once and can be drawn over and over, see gsgl_CreateTextRun
+typedef struct GSGL_RunGlyph {
+    int glyph;  // glyph index in the font it came from
+    int face;   // -1 for the run's font, otherwise the fallback font it came from
+    int offset; // byte offset of the character it came from
+    float x;    // pen position from the run's origin, kerning included
+    int y;      // baseline of its line, from the run's origin
+} GSGL_RunGlyph;
+
+typedef struct GSGL_TextBreak {
+    int glyph;      // index of the first glyph on the new line
+    bool mandatory; // a \n, not just somewhere it's allowed to wrap
+} GSGL_TextBreak;
+
+typedef struct GSGL_TextRun {
+    GSGL_Font font; // has to stay loaded as long as the run is around
+    float size;
+    float scale;
+
+    GSGL_RunGlyph* glyphs;
+    int glyphCount;
+    GSGL_TextBreak* breaks;
+    int breakCount;
+
+    Recti bounds; // ink bounds, from the run's origin
+    int width;    // advance width of the widest line
+    int height;   // line height times the number of lines
+
+    bool valid;
+} GSGL_TextRun;
+
 // input related
 typedef enum {
     GSGL_LMB = 0,
@@ -162,6 +228,11 @@ typedef enum {
 // modes
 GSGL_API void gsgl_SoftwareRender(); // Sets renderer mode to software.
 GSGL_API void gsgl_HardwareRender(); // Sets renderer mode to hardware-accelerated.
+GSGL_API void gsgl_HeadlessRender(); // Sets renderer mode to software, without ever opening a window.
+GSGL_API void gsgl_TiledRender(int threads); // Records draws and rasterizes them in tiles on a few threads during gsgl_SwapBuffers. 0 uses every core.
+GSGL_API void gsgl_ImmediateRender(); // Draws right away again (the default).
+GSGL_API void gsgl_RetainedRender(bool retained); // With tiled rendering, only redraws tiles whose draws changed since the last frame.
+GSGL_API void gsgl_SetBufferCount(int count); // Sets how many framebuffers get flipped between (2 or 3). Must be called before gsgl_InitWindow.
 
 // main stuff
 GSGL_API void gsgl_InitWindow(int width, int height, const char *title); // Initializes the library and the window.
@@ -170,6 +241,9 @@ GSGL_API bool gsgl_WindowReady(); // Returns if the window is ready.
 
 GSGL_API void gsgl_SetFrameRate(int framerate); // Sets the internal frame limiter.
 GSGL_API void gsgl_PollEvents(); // Polls events.
+GSGL_API bool gsgl_DrainEvents(); // Handles every queued window event without starting a new input frame. Returns true if something should be redrawn.
+GSGL_API bool gsgl_HasPendingEvents(); // Returns true if there are events waiting that wouldn't show up on the event fd.
+GSGL_API int gsgl_GetEventFd(); // Returns the fd of the window system connection, or -1 if there isn't one.
 GSGL_API bool gsgl_ShouldClose(); // Returns if the window is closing.
 
 GSGL_API void gsgl_GetLastError(); // Gets last Windows error
@@ -187,18 +261,29 @@ GSGL_API void gsgl_SwapBuffers(); // Swaps the buffers and resets the off-screen
 GSGL_API void gsgl_Pixel(int x, int y, Color col); // Draws a pixel.
 GSGL_API void gsgl_Rect(int x, int y, int width, int height, Color col); // Draws a rectangle.
 GSGL_API void gsgl_RectOutline(int x, int y, int width, int height, int thickness, Color col); // Draws a rectangle outline.
+GSGL_API void gsgl_DrawImage(const uint32_t* pixels, int x, int y, int width, int height); // Draws packed colors, blending them with what's behind.
+GSGL_API void gsgl_DrawMask(const uint8_t* mask, int stride, int x, int y, int width, int height, Color col); // Draws a solid color through an 8-bit coverage mask (glyphs).
 GSGL_API void gsgl_Clear(Color col); // Sets the buffer clear color.
 
+GSGL_API bool gsgl_SaveFramePPM(const char* fileName); // Saves the on-screen buffer as a binary PPM. Returns false if it couldn't.
+
 GSGL_API void gsgl_BufferAccess(int buffer, int index, uint32_t color); // Sets a value inside the buffer directly. Use if you know what you're doing.
 
+// blending
+GSGL_API void gsgl_BlendSpan(uint32_t* dst, const uint32_t* src, int count); // Blends a row of packed colors onto a row of pixels.
+GSGL_API void gsgl_BlendSpanColor(uint32_t* dst, uint32_t color, int count); // Blends one packed color onto a row of pixels.
+GSGL_API void gsgl_BlendMaskSpan(uint32_t* dst, const uint8_t* mask, uint32_t color, int count); // Blends one packed color onto a row of pixels, scaled by 8-bit coverage.
+GSGL_API const char* gsgl_GetBlendKernelName(); // Returns the name of the blending kernels in use (scalar, SSE2, AVX2)
+
 // scissors
 GSGL_API void gsgl_ScissorsStart(int x, int y, int width, int height); // Starts "scissors". Clips any further pixels that will get drawn into a rect.
 GSGL_API void gsgl_ScissorsStop(); // Stops "scissors".
 
-// write box
-GSGL_API void gsgl_WriteBoxReset();
-GSGL_API void gsgl_WriteBoxSet(int x, int y, int width, int height);
-GSGL_API void gsgl_WriteBoxUpdate(int x, int y);
+// damage
+GSGL_API void gsgl_DamageReset(); // Forgets everything that was drawn this frame.
+GSGL_API void gsgl_DamageRect(int x, int y, int width, int height); // Marks a part of the off-screen buffer as changed.
+GSGL_API void gsgl_DamageFull(); // Marks the whole off-screen buffer as changed.
+GSGL_API void gsgl_DamagePresentFull(); // Makes the next gsgl_Draw send the whole on-screen buffer.
 
 // some utils
 GSGL_API float gsgl_Lerp(float start, float end, float amount); // Interpolates a number.
@@ -223,6 +308,7 @@ GSGL_API bool gsgl_IsMouseButtonUp(GSGL_MouseButton button); // Returns true if
 
 GSGL_API bool gsgl_IsMouseButtonPressed(GSGL_MouseButton button); // Returns true if the mouse button is pressed
 GSGL_API bool gsgl_IsMouseButtonReleased(GSGL_MouseButton button); // Returns true if the mouse button is released
+GSGL_API int gsgl_GetMouseWheel(); // Returns how many notches the wheel moved this frame, positive is away from the user
 
 GSGL_API void gsgl_SetCursor(GSGL_Cursor cursor); // Sets cursor icon
 
@@ -234,18 +320,44 @@ GSGL_API bool gsgl_IsKeyPressed(GSGL_Key key); // Returns true if specific key i
 GSGL_API bool gsgl_IsKeyReleased(GSGL_Key key); // Returns true if specific key is released
 
 GSGL_API bool gsgl_IsKeyRepeat(GSGL_Key key); // Returns true if specific key is pressed, with repeat capability
+GSGL_API bool gsgl_IsInputHeld(); // Returns true if any key or mouse button is down
 
 GSGL_API char gsgl_GetLastChar(); // Returns the last character
 
+// injected input
+// queued up and applied on the next gsgl_PollEvents, as if it came from the window
+GSGL_API void gsgl_InjectKey(GSGL_Key key, bool down); // Presses or releases a key
+GSGL_API void gsgl_InjectMouseButton(GSGL_MouseButton button, bool down); // Presses or releases a mouse button
+GSGL_API void gsgl_InjectMouseMove(int x, int y); // Moves the mouse
+GSGL_API void gsgl_InjectMouseWheel(int notches); // Scrolls the wheel, positive is away from the user
+GSGL_API void gsgl_InjectChar(char character); // Types a character
+GSGL_API void gsgl_InjectResize(int width, int height); // Resizes the framebuffers, mostly for headless mode
+
 // == TEXT & FONTS
-GSGL_API GSGL_Font gsgl_LoadFont(const char* fileName); // Loads a font.
+GSGL_API GSGL_Font gsgl_LoadFont(const char* fileName); // Gets a handle for a font file. It's only mapped once it gets used, loading it again shares it.
+GSGL_API GSGL_Font gsgl_LoadFontFromMemory(const uint8_t* data, size_t size, const char* name); // Gets a handle for a font that's already in memory, like an embedded one. The data has to outlive the handle.
+GSGL_API void gsgl_AddBakedGlyphs(GSGL_Font font, const GSGL_BakedAtlas* atlas); // Puts prerasterized glyphs into the glyph cache, they never get thrown out. The atlas has to outlive the handle.
 GSGL_API GSGL_Font gsgl_InvalidFont(); // Returns a invalid font.
-GSGL_API void gsgl_UnloadFont(GSGL_Font font); // Unloads a font.
+GSGL_API void gsgl_UnloadFont(GSGL_Font font); // Lets go of a font handle, the last one unmaps the file.
 GSGL_API void gsgl_DrawText(GSGL_Font font, const char* text, int x, int y, float font_size, Color col); // Draws text.
 GSGL_API bool gsgl_IsFontValid(GSGL_Font font); // Returns true if the font is valid
 
+GSGL_API GSGL_TextRun gsgl_CreateTextRun(GSGL_Font font, const char* text, float font_size); // Lays out UTF-8 text with kerning, to be drawn later.
+GSGL_API void gsgl_UnloadTextRun(GSGL_TextRun run); // Frees a text run.
+GSGL_API void gsgl_DrawTextRun(const GSGL_TextRun* run, int x, int y, Color col); // Draws a text run with its origin at x, y.
+GSGL_API bool gsgl_IsTextRunReady(const GSGL_TextRun* run); // True once every glyph of the run is rasterized, so drawing it won't wait. Never waits itself.
+
+GSGL_API void gsgl_SetGlyphCacheBudget(size_t bytes); // Sets how much memory the glyph atlas can take up before old pages get thrown out.
+GSGL_API size_t gsgl_GetGlyphCacheSize(); // Returns how much memory the glyph atlas takes up right now.
+
+GSGL_API void gsgl_AddFallbackFont(const char* fileName); // Adds a font to the end of the fallback chain, it only gets opened once a codepoint misses.
+GSGL_API void gsgl_AddFallbackDirectory(const char* path); // Adds every .ttf/.otf in a directory to the fallback chain, the first time a codepoint misses.
+GSGL_API void gsgl_UnloadFallbackFonts(); // Closes every fallback font that got opened.
+
 GSGL_API Vector2i gsgl_GetCodepointSize(GSGL_Font font, const char *codepoint, float font_size);
 GSGL_API Vector2i gsgl_GetTextSize(GSGL_Font font, const char *text, float font_size);
+GSGL_API int gsgl_GetLineHeight(GSGL_Font font, float font_size); // How far apart lines are, same as gsgl_DrawText uses for \n.
+GSGL_API const GSGL_TextMetrics* gsgl_MeasureText(GSGL_Font font, const char* text, float font_size); // Cached prefix advances of the text. Valid until the next gsgl_SwapBuffers.
 
 // == UTILS
 GSGL_API bool gsgl_IsPointInRect(Vector2i point, Vector2i pos, Vector2i size);
@@ -4,137 +4,1306 @@
 
 // This is the text side of things
 
+/*
+
+Glyph cache:
+- Rasterizing a glyph is by far the most expensive part of drawing text, and the same ~95 glyphs get drawn over and over.
+  So every glyph gets rasterized once per (font, glyph, pixel size, subpixel offset) and kept, together with its metrics.
+- Pens move in fractional pixels, so nothing drifts along a line and measured widths are the drawn widths.
+  The fraction gets rounded to one of GSGL_GLYPH_PHASES offsets, which keeps it to at most 4 bitmaps per glyph.
+- Fonts can come with glyphs baked at build time (gsgl_AddBakedGlyphs). Those go into the cache like any other glyph,
+  except their coverage stays in the binary and they never get thrown out.
+
+- The coverage bitmaps get packed into 256x256 A8 atlas pages, row by row ("shelves").
+  Pages get thrown out whole, least recently used first, once the cache goes over its byte budget (gsgl_SetGlyphCacheBudget).
+  Throwing out single glyphs would just leave holes nobody can use.
+
+- Rasterizing happens on a few worker threads, never on the thread that's drawing. Looking a glyph up for the first time
+  (measuring, laying out a run) only works out its metrics and queues the bitmap. Finished bitmaps get pushed onto
+  a lock-free stack, and the drawing thread moves them into the atlas whenever it looks (every frame, or when it needs one).
+  Drawing a glyph that isn't done yet waits for it rather than drawing a placeholder, but by then layout has usually
+  queued everything around it, so it's all getting rasterized in parallel.
+  Callers that would rather not wait at all ask gsgl_IsTextRunReady first and draw the run a frame later.
+
+Text measurement:
+- The UI measures the same strings every frame (button labels, the text before the caret). gsgl_MeasureText keeps
+  a prefix advance table per (font, size, string), so any substring starting at 0 is one lookup, and any other one is two.
+- Entries that weren't used during a frame get dropped at gsgl_SwapBuffers once there are too many of them,
+  which is also why the returned pointer is only good until then.
+
+Text runs:
+- gsgl_CreateTextRun lays a UTF-8 string out once: glyph ids, kerned pen positions, line breaks, bounds.
+  Drawing one is then just blitting cached glyphs at an offset, so anything that doesn't change between frames
+  should be a run instead of a gsgl_DrawText call.
+
+Font registry:
+- gsgl_LoadFont doesn't read anything, it just hands out a handle for the file. Loading the same file twice gives the same handle.
+  The file gets mapped read-only the first time something actually draws or measures with it,
+  and every size and every user shares that one parsed face. gsgl_UnloadFont drops a reference, the last one unmaps it.
+- Fonts that are already in memory (embedded ones, gsgl_LoadFontFromMemory) work the same, minus the mapping.
+
+Fallback fonts:
+- All text is UTF-8. A codepoint the font doesn't have goes down the fallback chain (gsgl_AddFallbackFont/Directory).
+  Nothing in the chain gets opened until a codepoint actually misses, and fonts get opened one at a time, in order,
+  until one of them has it. Every opened font gets a coverage bitset built straight from its cmap, so asking it again is a bit test.
+- Whatever a codepoint resolves to is remembered, including "nobody has it", so a miss costs once.
+
+*/
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "../../logger.h"
 #include "gsgl.h"
 
+#ifdef _WIN32
+#define NOMINMAX // windows.h min/max macros break std::min and std::max
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #define STBTT_STATIC
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "libs/stb_truetype.h"
 
+// graphics.cpp
+void gi_DrawMask(const uint8_t* mask, int stride, int x, int y, int width, int height, Color col, uint64_t key);
+
+// tiles.cpp
+void gi_TilesDetach();
+void gi_TilesInvalidate();
+
+// == GLYPH CACHE
+#define GSGL_ATLAS_PAGE_SIZE 256
+#define GSGL_GLYPH_CACHE_BUDGET (4 * 1024 * 1024) // 64 pages
+#define GSGL_GLYPH_PHASES 4 // subpixel offsets per pixel
+
+typedef struct gi_GlyphKey {
+    const void* font; // the font data, that's the one thing that stays the same for a loaded font
+    int glyph;
+    int size;         // pixel size in 1/64ths
+    int phase;        // subpixel offset, in 1/GSGL_GLYPH_PHASES of a pixel
+
+    bool operator==(const gi_GlyphKey& other) const {
+        return font == other.font && glyph == other.glyph && size == other.size && phase == other.phase;
+    }
+} gi_GlyphKey;
+
+struct gi_GlyphKeyHash {
+    size_t operator()(const gi_GlyphKey& key) const {
+        size_t hash = std::hash<const void*>()(key.font);
+        hash = hash * 31 + (size_t)key.glyph;
+        hash = hash * 31 + (size_t)key.size;
+        hash = hash * 31 + (size_t)key.phase;
+        return hash;
+    }
+};
+
+typedef struct gi_Glyph {
+    // metrics
+    float advance; // scaled, not rounded
+    int x0;        // bitmap offset from the pen position
+    int y0;
+    int width;
+    int height;
+
+    // where the coverage is. -1 if there's nothing to draw (spaces), or if it's still being rasterized
+    int page;
+    int atlasX;
+    int atlasY;
+    bool pending; // a worker has it
+
+    // baked glyphs draw straight out of the baked atlas instead, page is -1 for them
+    const unsigned char* baked;
+    int bakedStride;
+
+    uint64_t id; // the same for the same bitmap, so retained tiles don't have to look at the pixels
+} gi_Glyph;
+
+typedef struct gi_AtlasPage {
+    unsigned char* pixels;
+    int width;
+    int height;
+
+    // shelf packing
+    int shelfX;
+    int shelfY;
+    int shelfHeight;
+
+    uint64_t lastUsed;
+    std::vector<gi_GlyphKey> glyphs; // so they can be forgotten when the page goes
+} gi_AtlasPage;
+
+static struct {
+    std::unordered_map<gi_GlyphKey, gi_Glyph, gi_GlyphKeyHash> glyphs;
+    std::vector<gi_AtlasPage> pages;
+
+    size_t bytes;
+    size_t budget = GSGL_GLYPH_CACHE_BUDGET;
+    uint64_t clock; // goes up once per draw call, for the LRU
+} glyphCache;
+
+static uint64_t gi_GlyphId(const gi_GlyphKey& key) {
+    uint64_t id = (uint64_t)(uintptr_t)key.font;
+    id = id * 0x100000001B3ULL + (uint64_t)key.glyph;
+    id = id * 0x100000001B3ULL + (uint64_t)key.size;
+    id = id * 0x100000001B3ULL + (uint64_t)key.phase;
+    return id;
+}
+
+static void gi_AtlasResetPage(gi_AtlasPage* page) {
+    for (const gi_GlyphKey& key : page->glyphs) {
+        glyphCache.glyphs.erase(key);
+    }
+    page->glyphs.clear();
+
+    page->shelfX = 0;
+    page->shelfY = 0;
+    page->shelfHeight = 0;
+}
+
+// finds room for a width x height bitmap, making a new page or throwing out old ones if needed.
+// -1 if it wouldn't fit in the budget even on its own
+static int gi_AtlasAllocate(int width, int height, int* x, int* y) {
+    // the newest page is the only one that's still being filled
+    if (glyphCache.pages.empty() == false) {
+        int index = (int)glyphCache.pages.size() - 1;
+        gi_AtlasPage* page = &glyphCache.pages[index];
+
+        if (page->shelfX + width > page->width) {
+            page->shelfY += page->shelfHeight;
+            page->shelfX = 0;
+            page->shelfHeight = 0;
+        }
+        if (width <= page->width && page->shelfY + height <= page->height) {
+            *x = page->shelfX;
+            *y = page->shelfY;
+            page->shelfX += width;
+            page->shelfHeight = std::max(page->shelfHeight, height);
+            return index;
+        }
+    }
+
+    // big glyphs get a page of their own size
+    int pageWidth = std::max(GSGL_ATLAS_PAGE_SIZE, width);
+    int pageHeight = std::max(GSGL_ATLAS_PAGE_SIZE, height);
+    size_t pageBytes = (size_t)pageWidth * pageHeight;
+    if (pageBytes > glyphCache.budget) return -1;
+
+    // over budget, reuse the least recently used page instead
+    if (glyphCache.bytes + pageBytes > glyphCache.budget && glyphCache.pages.empty() == false) {
+        int oldest = 0;
+        for (int i = 1; i < (int)glyphCache.pages.size(); i++) {
+            if (glyphCache.pages[i].lastUsed < glyphCache.pages[oldest].lastUsed) oldest = i;
+        }
+
+        // the tiles might still be reading glyphs out of it this frame
+        gi_TilesDetach();
+
+        gi_AtlasPage page = glyphCache.pages[oldest];
+        gi_AtlasResetPage(&page);
+        glyphCache.pages.erase(glyphCache.pages.begin() + oldest);
+
+        // every glyph after it moved down by one page
+        for (auto& entry : glyphCache.glyphs) {
+            if (entry.second.page > oldest) entry.second.page--;
+        }
+
+        if (page.width < pageWidth || page.height < pageHeight) {
+            // too small for it, and there might still not be room for a bigger one. keep going until there is
+            glyphCache.bytes -= (size_t)page.width * page.height;
+            free(page.pixels);
+        } else {
+            // moves to the back, where new glyphs go
+            glyphCache.pages.push_back(page);
+        }
+        return gi_AtlasAllocate(width, height, x, y);
+    }
+
+    gi_AtlasPage page = {};
+    page.width = pageWidth;
+    page.height = pageHeight;
+    page.pixels = (unsigned char*)malloc(pageBytes);
+    page.lastUsed = glyphCache.clock;
+    glyphCache.bytes += pageBytes;
+    glyphCache.pages.push_back(page);
+
+    return gi_AtlasAllocate(width, height, x, y);
+}
+
+// == GLYPH WORKERS
+#define GSGL_GLYPH_WORKERS 4 // at most
+
+typedef struct gi_GlyphJob {
+    gi_GlyphKey key;
+    const stbtt_fontinfo* font; // the registry keeps these in place
+    float scale;
+    int width;
+    int height;
+} gi_GlyphJob;
+
+typedef struct gi_GlyphResult {
+    gi_GlyphKey key;
+    unsigned char* bitmap; // width x height, tightly packed
+    int width;
+    gi_GlyphResult* next;
+} gi_GlyphResult;
+
+static struct {
+    std::vector<std::thread> threads;
+    bool started;
+    bool stopped; // after this everything gets rasterized right where it's asked for
+
+    std::mutex lock;
+    std::condition_variable wake;     // jobs came in
+    std::condition_variable finished; // a result came out
+    std::deque<gi_GlyphJob> jobs;
+    int busy;
+    bool quit;
+
+    // finished bitmaps, pushed by the workers and taken all at once by the drawing thread
+    std::atomic<gi_GlyphResult*> results;
+} glyphWorkers;
+
+static void gi_GlyphWorker() {
+    while (true) {
+        gi_GlyphJob job;
+        {
+            std::unique_lock<std::mutex> guard(glyphWorkers.lock);
+            glyphWorkers.wake.wait(guard, [] { return glyphWorkers.quit == true || glyphWorkers.jobs.empty() == false; });
+            if (glyphWorkers.quit == true) return;
+
+            job = glyphWorkers.jobs.front();
+            glyphWorkers.jobs.pop_front();
+            glyphWorkers.busy++;
+        }
+
+        gi_GlyphResult* result = new gi_GlyphResult();
+        result->key = job.key;
+        result->width = job.width;
+        result->bitmap = (unsigned char*)malloc((size_t)job.width * job.height);
+        stbtt_MakeGlyphBitmapSubpixel(job.font, result->bitmap, job.width, job.height, job.width, job.scale, job.scale, job.key.phase / (float)GSGL_GLYPH_PHASES, 0, job.key.glyph);
+
+        // no lock needed to hand it over, the drawing thread only ever takes the whole stack
+        result->next = glyphWorkers.results.load(std::memory_order_relaxed);
+        while (!glyphWorkers.results.compare_exchange_weak(result->next, result, std::memory_order_release, std::memory_order_relaxed)) {}
+
+        {
+            std::lock_guard<std::mutex> guard(glyphWorkers.lock);
+            glyphWorkers.busy--;
+        }
+        glyphWorkers.finished.notify_all();
+    }
+}
+
+// started the first time a glyph needs rasterizing. false if there aren't going to be any workers
+static bool gi_GlyphWorkersStart() {
+    if (glyphWorkers.stopped == true) return false;
+    if (glyphWorkers.started == true) return true;
+
+    int threads = std::min(std::max((int)std::thread::hardware_concurrency() / 2, 1), GSGL_GLYPH_WORKERS);
+    for (int i = 0; i < threads; i++) {
+        glyphWorkers.threads.emplace_back(gi_GlyphWorker);
+    }
+    glyphWorkers.started = true;
+
+    Logger_log(LOGGER_INFO, "GRAPHICS: - Rasterizing glyphs on %d thread(s)", threads);
+    return true;
+}
+
+// called from gsgl_CloseWindow
+void gi_GlyphWorkersStop() {
+    if (glyphWorkers.started == true) {
+        {
+            std::lock_guard<std::mutex> guard(glyphWorkers.lock);
+            glyphWorkers.quit = true;
+        }
+        glyphWorkers.wake.notify_all();
+
+        for (std::thread& thread : glyphWorkers.threads) thread.join();
+        glyphWorkers.threads.clear();
+        glyphWorkers.jobs.clear();
+    }
+    glyphWorkers.stopped = true;
+}
+
+// waits until nothing of this font is being rasterized anymore, so it can be unmapped
+static void gi_GlyphWorkersForget(const void* font) {
+    std::unique_lock<std::mutex> guard(glyphWorkers.lock);
+    glyphWorkers.jobs.erase(std::remove_if(glyphWorkers.jobs.begin(), glyphWorkers.jobs.end(), [font](const gi_GlyphJob& job) { return job.key.font == font; }), glyphWorkers.jobs.end());
+    glyphWorkers.finished.wait(guard, [] { return glyphWorkers.busy == 0; });
+}
+
+// puts a glyph's coverage into the atlas. without a bitmap it gets rasterized right here
+static void gi_PlaceGlyph(const gi_GlyphKey& key, gi_Glyph* entry, const unsigned char* bitmap, const stbtt_fontinfo* font, float scale) {
+    entry->pending = false;
+    entry->page = gi_AtlasAllocate(entry->width, entry->height, &entry->atlasX, &entry->atlasY);
+    if (entry->page == -1) {
+        Logger_log(LOGGER_WARNING, "GRAPHICS: A %dx%d glyph doesn't fit in the glyph cache budget, it won't be drawn", entry->width, entry->height);
+        return;
+    }
+
+    gi_AtlasPage* page = &glyphCache.pages[entry->page];
+    page->lastUsed = glyphCache.clock;
+    page->glyphs.push_back(key);
+
+    unsigned char* out = page->pixels + entry->atlasY * page->width + entry->atlasX;
+    if (bitmap != NULL) {
+        for (int j = 0; j < entry->height; j++) {
+            memcpy(out + j * page->width, bitmap + j * entry->width, entry->width);
+        }
+    } else {
+        // straight into the atlas, no temporary bitmap
+        stbtt_MakeGlyphBitmapSubpixel(font, out, entry->width, entry->height, page->width, scale, scale, key.phase / (float)GSGL_GLYPH_PHASES, 0, key.glyph);
+    }
+}
+
+// moves everything the workers finished into the atlas
+static void gi_PublishGlyphs() {
+    gi_GlyphResult* result = glyphWorkers.results.exchange(NULL, std::memory_order_acquire);
+
+    while (result != NULL) {
+        // it might have been purged while it was being rasterized
+        auto found = glyphCache.glyphs.find(result->key);
+        if (found != glyphCache.glyphs.end() && found->second.pending == true) {
+            gi_PlaceGlyph(found->first, &found->second, result->bitmap, NULL, 0.0f);
+        }
+
+        gi_GlyphResult* next = result->next;
+        free(result->bitmap);
+        delete result;
+        result = next;
+    }
+}
+
+// returns the cached glyph. if it isn't there yet the metrics get worked out right away,
+// and the bitmap gets queued for the workers. use gi_WaitForGlyph before drawing it
+static const gi_Glyph* gi_GetGlyph(const stbtt_fontinfo* font, int glyph, float size, float scale, int phase) {
+    gi_GlyphKey key = {font->data, glyph, (int)(size * 64.0f + 0.5f), phase};
+
+    auto found = glyphCache.glyphs.find(key);
+    if (found != glyphCache.glyphs.end()) {
+        if (found->second.page != -1) glyphCache.pages[found->second.page].lastUsed = glyphCache.clock;
+        return &found->second;
+    }
+
+    gi_Glyph entry = {};
+
+    int advance, lsb;
+    stbtt_GetGlyphHMetrics(font, glyph, &advance, &lsb);
+    entry.advance = advance * scale;
+
+    int x0, y0, x1, y1;
+    stbtt_GetGlyphBitmapBoxSubpixel(font, glyph, scale, scale, phase / (float)GSGL_GLYPH_PHASES, 0, &x0, &y0, &x1, &y1);
+    entry.x0 = x0;
+    entry.y0 = y0;
+    entry.width = x1 - x0;
+    entry.height = y1 - y0;
+    entry.page = -1;
+    entry.id = gi_GlyphId(key);
+
+    gi_Glyph* stored = &(glyphCache.glyphs[key] = entry);
+    if (entry.width > 0 && entry.height > 0) {
+        if (gi_GlyphWorkersStart() == true) {
+            stored->pending = true;
+            {
+                std::lock_guard<std::mutex> guard(glyphWorkers.lock);
+                glyphWorkers.jobs.push_back({key, font, scale, entry.width, entry.height});
+            }
+            glyphWorkers.wake.notify_one();
+        } else {
+            gi_PlaceGlyph(key, stored, NULL, font, scale);
+        }
+    }
+
+    return stored;
+}
+
+// same as gi_GetGlyph, but the coverage is in the atlas by the time it returns
+static const gi_Glyph* gi_WaitForGlyph(const stbtt_fontinfo* font, int glyph, float size, float scale, int phase) {
+    gi_GlyphKey key = {font->data, glyph, (int)(size * 64.0f + 0.5f), phase};
+
+    while (true) {
+        const gi_Glyph* entry = gi_GetGlyph(font, glyph, size, scale, phase);
+        if (entry->pending == false) return entry;
+
+        if (glyphWorkers.stopped == true) {
+            gi_PlaceGlyph(key, &glyphCache.glyphs[key], NULL, font, scale);
+            return &glyphCache.glyphs[key];
+        }
+
+        gi_PublishGlyphs();
+
+        // publishing can throw pages out, so look it up again. if it got thrown out it just gets queued again
+        auto found = glyphCache.glyphs.find(key);
+        if (found != glyphCache.glyphs.end() && found->second.pending == false) return &found->second;
+        if (found == glyphCache.glyphs.end()) continue;
+
+        std::unique_lock<std::mutex> guard(glyphWorkers.lock);
+        glyphWorkers.finished.wait(guard, [] { return glyphWorkers.results.load(std::memory_order_acquire) != NULL; });
+    }
+}
+
+// splits a fractional pen position into the pixel it's in and the closest phase
+static int gi_SnapPen(float x, int* phase) {
+    int pixel = (int)std::floor(x);
+    *phase = (int)((x - pixel) * GSGL_GLYPH_PHASES + 0.5f);
+    if (*phase == GSGL_GLYPH_PHASES) {
+        pixel++;
+        *phase = 0;
+    }
+    return pixel;
+}
+
+// draws a cached glyph with its pen position at x, y. it has to be out of gi_WaitForGlyph
+static void gi_BlitGlyph(const gi_Glyph* glyph, int x, int y, Color col) {
+    if (glyph->baked != NULL) {
+        gi_DrawMask(glyph->baked, glyph->bakedStride, x + glyph->x0, y + glyph->y0, glyph->width, glyph->height, col, glyph->id);
+        return;
+    }
+    if (glyph->page == -1) return;
+
+    // straight out of the atlas, clipping and blending are done by gi_DrawMask
+    const gi_AtlasPage* page = &glyphCache.pages[glyph->page];
+    const uint8_t* coverage = page->pixels + glyph->atlasY * page->width + glyph->atlasX;
+    gi_DrawMask(coverage, page->width, x + glyph->x0, y + glyph->y0, glyph->width, glyph->height, col, glyph->id);
+}
+
+// forgets every glyph of a font, its data pointer might get reused by something else later
+static void gi_GlyphCachePurge(const void* font) {
+    // the ids of its glyphs might mean something else once the pointer gets reused, and baked pixels might go with it
+    gi_TilesDetach();
+    gi_TilesInvalidate();
+
+    for (auto it = glyphCache.glyphs.begin(); it != glyphCache.glyphs.end();) {
+        if (it->first.font == font) it = glyphCache.glyphs.erase(it);
+        else it++;
+    }
+
+    // the pages stay, they just can't be found anymore. they'll get thrown out by the LRU
+    for (gi_AtlasPage& page : glyphCache.pages) {
+        page.glyphs.erase(std::remove_if(page.glyphs.begin(), page.glyphs.end(), [font](const gi_GlyphKey& key) { return key.font == font; }), page.glyphs.end());
+    }
+}
+
+// == FONT REGISTRY
+typedef struct gi_Face {
+    std::string path;
+    int refs;
+    bool opened;
+    bool failed;
+    bool memory; // the data belongs to whoever loaded it, nothing to map
+
+    const GSGL_BakedAtlas* baked;
+
+    // the mapped file, read-only
+    unsigned char* data;
+    size_t size;
+    #ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+    #endif
+
+    stbtt_fontinfo info;
+} gi_Face;
+
+// a handle's id is its index + 1, ids never get reused. deque so faces don't move when more get added
+static std::deque<gi_Face> faces;
+
+static void gi_MeasureCachePurge(const void* font);
+
+static bool gi_MapFace(gi_Face* face) {
+    #ifdef _WIN32
+    face->file = CreateFileA(face->path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (face->file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(face->file, &size);
+    face->size = (size_t)size.QuadPart;
+
+    face->mapping = CreateFileMappingA(face->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (face->mapping != NULL) face->data = (unsigned char*)MapViewOfFile(face->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (face->data == NULL) {
+        if (face->mapping != NULL) CloseHandle(face->mapping);
+        CloseHandle(face->file);
+        return false;
+    }
+    #else
+    int fd = open(face->path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    face->size = (size_t)info.st_size;
+
+    // the mapping keeps the file alive by itself
+    void* data = mmap(NULL, face->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    face->data = (unsigned char*)data;
+    #endif
+
+    return true;
+}
+static void gi_UnmapFace(gi_Face* face) {
+    #ifdef _WIN32
+    UnmapViewOfFile(face->data);
+    CloseHandle(face->mapping);
+    CloseHandle(face->file);
+    #else
+    munmap(face->data, face->size);
+    #endif
+
+    face->data = NULL;
+    face->size = 0;
+}
+
+// puts a face's baked glyphs into the cache, they're gone again whenever it gets purged
+static void gi_AddBakedGlyphs(gi_Face* face) {
+    const GSGL_BakedAtlas* atlas = face->baked;
+
+    for (int i = 0; i < atlas->glyphCount; i++) {
+        const GSGL_BakedGlyph* baked = &atlas->glyphs[i];
+        if (baked->phase < 0 || baked->phase >= GSGL_GLYPH_PHASES) continue;
+
+        gi_Glyph entry = {};
+        entry.advance = baked->advance;
+        entry.x0 = baked->x0;
+        entry.y0 = baked->y0;
+        entry.width = baked->width;
+        entry.height = baked->height;
+        entry.page = -1;
+        if (baked->width > 0 && baked->height > 0) {
+            entry.baked = atlas->pixels + baked->atlasY * atlas->width + baked->atlasX;
+            entry.bakedStride = atlas->width;
+        }
+
+        gi_GlyphKey key = {face->data, baked->glyph, baked->size, baked->phase};
+        entry.id = gi_GlyphId(key);
+        glyphCache.glyphs[key] = entry;
+    }
+}
+
+// the face behind a handle, mapping it first if this is the first time it's used. NULL if it can't be used
+static gi_Face* gi_GetFace(GSGL_Font font) {
+    if (font.valid == false || font.id < 1 || font.id > (int)faces.size()) return NULL;
+
+    gi_Face* face = &faces[font.id - 1];
+    if (face->refs <= 0 || face->failed == true) return NULL;
+    if (face->opened == true) return face;
+
+    if (face->memory == false && gi_MapFace(face) == false) {
+        Logger_log(LOGGER_ERROR, "GRAPHICS: Could not map font file '%s'.", face->path.c_str());
+        face->failed = true;
+        return NULL;
+    }
+    if (!stbtt_InitFont(&face->info, face->data, stbtt_GetFontOffsetForIndex(face->data, 0))) {
+        Logger_log(LOGGER_ERROR, "GRAPHICS: Could not initialize font '%s'.", face->path.c_str());
+        if (face->memory == false) gi_UnmapFace(face);
+        face->failed = true;
+        return NULL;
+    }
+
+    face->opened = true;
+    if (face->baked != NULL) gi_AddBakedGlyphs(face);
+
+    if (face->memory == false) Logger_log(LOGGER_INFO, "GRAPHICS: Mapped font '%s' (%zu KB).", face->path.c_str(), face->size / 1024);
+    return face;
+}
+
 GSGL_Font gsgl_LoadFont(const char* fileName) {
     GSGL_Font font = { 0 };
-    
-    FILE* file = fopen(fileName, "rb");
-    if (!file) {
+    font.valid = false;
+
+    // already there, share it
+    for (int i = 0; i < (int)faces.size(); i++) {
+        if (faces[i].refs > 0 && faces[i].memory == false && faces[i].path == fileName) {
+            faces[i].refs++;
+            font.id = i + 1;
+            font.valid = true;
+            return font;
+        }
+    }
+
+    // only check that it's there, reading it waits until it's needed
+    std::error_code error;
+    if (std::filesystem::is_regular_file(fileName, error) == false) {
         Logger_log(LOGGER_ERROR, "GRAPHICS: Could not open font file '%s'.", fileName);
-        font.valid = false;
-    } else {
-        // Read the font file into a buffer
-        fseek(file, 0, SEEK_END);
-        size_t size = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        font.font_buffer = (unsigned char*)malloc(size);
-        fread(font.font_buffer, 1, size, file);
-        fclose(file);
-
-        // Initialize the font
-        if (!stbtt_InitFont(&font.font, font.font_buffer, stbtt_GetFontOffsetForIndex(font.font_buffer, 0))) {
-            Logger_log(LOGGER_ERROR, "GRAPHICS: Could not initialize font.");
-            free(font.font_buffer);
-            font.valid = false;
-        } else {
+        return font;
+    }
+
+    gi_Face face = {};
+    face.path = fileName;
+    face.refs = 1;
+    faces.push_back(face);
+
+    font.id = (int)faces.size();
+    font.valid = true;
+    return font;
+}
+GSGL_Font gsgl_LoadFontFromMemory(const uint8_t* data, size_t size, const char* name) {
+    GSGL_Font font = { 0 };
+    font.valid = false;
+    if (data == NULL || size == 0) return font;
+
+    for (int i = 0; i < (int)faces.size(); i++) {
+        if (faces[i].refs > 0 && faces[i].memory == true && faces[i].data == data) {
+            faces[i].refs++;
+            font.id = i + 1;
             font.valid = true;
+            return font;
         }
     }
 
+    gi_Face face = {};
+    face.path = name;
+    face.refs = 1;
+    face.memory = true;
+    face.data = (unsigned char*)data;
+    face.size = size;
+    faces.push_back(face);
+
+    font.id = (int)faces.size();
+    font.valid = true;
     return font;
 }
+void gsgl_AddBakedGlyphs(GSGL_Font font, const GSGL_BakedAtlas* atlas) {
+    if (font.valid == false || font.id < 1 || font.id > (int)faces.size()) return;
+
+    gi_Face* face = &faces[font.id - 1];
+    if (face->refs <= 0) return;
+
+    // if it isn't open yet they go in when it is
+    face->baked = atlas;
+    if (face->opened == true) gi_AddBakedGlyphs(face);
+}
 GSGL_Font gsgl_InvalidFont() {
     GSGL_Font font = { 0 };
     font.valid = false;
     return font;
 }
 void gsgl_UnloadFont(GSGL_Font font) {
-    font.valid = false;
-    free(font.font_buffer);
+    if (font.valid == false || font.id < 1 || font.id > (int)faces.size()) return;
+
+    gi_Face* face = &faces[font.id - 1];
+    if (face->refs <= 0) return;
+
+    face->refs--;
+    if (face->refs > 0) return;
+
+    if (face->opened == true) {
+        // nothing can be reading it on another thread when it goes
+        gi_GlyphWorkersForget(face->data);
+        gi_PublishGlyphs();
+
+        // its data pointer might get reused by another mapping later
+        gi_GlyphCachePurge(face->data);
+        gi_MeasureCachePurge(face->data);
+        if (face->memory == false) gi_UnmapFace(face);
+        face->opened = false;
+    }
 }
+bool gsgl_IsFontValid(GSGL_Font font) {
+    if (font.valid == false || font.id < 1 || font.id > (int)faces.size()) return false;
 
-Vector2i gsgl_GetCodepointSize(GSGL_Font font, const char* codepoint, float font_size) {
-    float scale = stbtt_ScaleForPixelHeight(&font.font, font_size);
-    int x0, y0, x1, y1;
-    stbtt_GetCodepointBitmapBox(&font.font, (int)*codepoint, scale, scale, &x0, &y0, &x1, &y1);
-    return {x1 - x0, y1 - y0};
+    const gi_Face* face = &faces[font.id - 1];
+    return face->refs > 0 && face->failed == false;
 }
-Vector2i gsgl_GetTextSize(GSGL_Font font, const char* text, float font_size) {
-    float scale = stbtt_ScaleForPixelHeight(&font.font, font_size);
 
-    int width = 0;
-    int height = 0;
+// == UTF-8 & FALLBACK FONTS
+// reads one codepoint and moves p past it. broken sequences come out as U+FFFD, one byte at a time
+static int gi_DecodeUTF8(const char** p) {
+    const unsigned char* s = (const unsigned char*)*p;
+
+    int codepoint;
+    int length;
+    if (s[0] < 0x80) { codepoint = s[0]; length = 1; }
+    else if ((s[0] & 0xE0) == 0xC0) { codepoint = s[0] & 0x1F; length = 2; }
+    else if ((s[0] & 0xF0) == 0xE0) { codepoint = s[0] & 0x0F; length = 3; }
+    else if ((s[0] & 0xF8) == 0xF0) { codepoint = s[0] & 0x07; length = 4; }
+    else { *p += 1; return 0xFFFD; }
+
+    for (int i = 1; i < length; i++) {
+        // this also stops at the terminator
+        if ((s[i] & 0xC0) != 0x80) { *p += 1; return 0xFFFD; }
+        codepoint = (codepoint << 6) | (s[i] & 0x3F);
+    }
+
+    // overlong encodings and surrogates
+    static const int minimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+    if (codepoint < minimum[length] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        *p += 1;
+        return 0xFFFD;
+    }
+
+    *p += length;
+    return codepoint;
+}
+
+#define GSGL_COVERAGE_PAGE 4096 // codepoints per bitset page
+#define GSGL_COVERAGE_PAGES (0x110000 / GSGL_COVERAGE_PAGE)
+
+typedef struct gi_Coverage {
+    bool exact; // false when the cmap isn't format 4 or 12, then every codepoint is a maybe
+    std::vector<uint64_t> pages[GSGL_COVERAGE_PAGES]; // empty means nothing in that range
+} gi_Coverage;
+
+typedef struct gi_FallbackFont {
+    std::string path;
+    bool registered;
+    bool covered; // coverage is built
+
+    GSGL_Font font;
+    gi_Coverage coverage;
+} gi_FallbackFont;
+
+static struct {
+    std::deque<gi_FallbackFont> fonts; // deque so the fontinfos don't move around when more get added
+    std::vector<std::string> directories;
+    bool scanned;
+
+    std::unordered_map<int, int> resolved; // codepoint -> font in the chain, -1 if none of them have it
+} fallbacks;
+
+static void gi_CoverageAdd(gi_Coverage* coverage, uint32_t first, uint32_t last) {
+    last = std::min(last, (uint32_t)0x10FFFF);
+    for (uint32_t codepoint = first; codepoint <= last && codepoint >= first; codepoint++) {
+        std::vector<uint64_t>& page = coverage->pages[codepoint / GSGL_COVERAGE_PAGE];
+        if (page.empty()) page.assign(GSGL_COVERAGE_PAGE / 64, 0);
+
+        uint32_t bit = codepoint % GSGL_COVERAGE_PAGE;
+        page[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+}
+static bool gi_CoverageHas(const gi_Coverage* coverage, int codepoint) {
+    if (coverage->exact == false) return true;
+    if (codepoint < 0 || codepoint > 0x10FFFF) return false;
+
+    const std::vector<uint64_t>& page = coverage->pages[codepoint / GSGL_COVERAGE_PAGE];
+    if (page.empty()) return false;
+
+    uint32_t bit = codepoint % GSGL_COVERAGE_PAGE;
+    return (page[bit / 64] >> (bit % 64)) & 1;
+}
+
+// reads the ranges out of the cmap subtable stb_truetype picked. a range can still map to glyph 0,
+// so a set bit is a "probably", the glyph lookup that comes after it has the final say
+static void gi_BuildCoverage(const stbtt_fontinfo* font, gi_Coverage* coverage) {
+    stbtt_uint8* data = font->data;
+    int map = font->index_map;
+    int format = ttUSHORT(data + map);
+
+    if (format == 4) {
+        int segments = ttUSHORT(data + map + 6) / 2;
+        stbtt_uint8* endCodes = data + map + 14;
+        stbtt_uint8* startCodes = endCodes + segments * 2 + 2;
+
+        for (int i = 0; i < segments; i++) {
+            uint32_t first = ttUSHORT(startCodes + i * 2);
+            uint32_t last = ttUSHORT(endCodes + i * 2);
+            if (first == 0xFFFF) continue; // the terminating segment
+
+            gi_CoverageAdd(coverage, first, last);
+        }
+        coverage->exact = true;
+    } else if (format == 12 || format == 13) {
+        uint32_t groups = ttULONG(data + map + 12);
+        for (uint32_t i = 0; i < groups; i++) {
+            stbtt_uint8* group = data + map + 16 + i * 12;
+            gi_CoverageAdd(coverage, ttULONG(group), ttULONG(group + 4));
+        }
+        coverage->exact = true;
+    } else {
+        coverage->exact = false;
+    }
+}
+
+static gi_Face* gi_OpenFallback(gi_FallbackFont* fallback) {
+    if (fallback->registered == false) {
+        fallback->font = gsgl_LoadFont(fallback->path.c_str());
+        fallback->registered = true;
+    }
+
+    gi_Face* face = gi_GetFace(fallback->font);
+    if (face == NULL) return NULL;
+
+    if (fallback->covered == false) {
+        gi_BuildCoverage(&face->info, &fallback->coverage);
+        fallback->covered = true;
+        Logger_log(LOGGER_INFO, "GRAPHICS: Opened fallback font '%s'.", fallback->path.c_str());
+    }
+    return face;
+}
+
+// only happens the first time a codepoint misses
+static void gi_ScanFallbackDirectories() {
+    if (fallbacks.scanned == true) return;
+    fallbacks.scanned = true;
+
+    for (const std::string& directory : fallbacks.directories) {
+        std::vector<std::string> files;
+
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (extension == ".ttf" || extension == ".otf") files.push_back(entry.path().string());
+        }
+        if (error) Logger_log(LOGGER_WARNING, "GRAPHICS: Could not read font directory '%s'.", directory.c_str());
+
+        // directory order isn't stable, the chain should be
+        std::sort(files.begin(), files.end());
+        for (const std::string& file : files) gsgl_AddFallbackFont(file.c_str());
+    }
+}
+
+// which font in the chain has the codepoint, -1 if none of them do
+static int gi_FindFallback(int codepoint) {
+    auto found = fallbacks.resolved.find(codepoint);
+    if (found != fallbacks.resolved.end()) return found->second;
+
+    gi_ScanFallbackDirectories();
+
+    int result = -1;
+    for (int i = 0; i < (int)fallbacks.fonts.size() && result == -1; i++) {
+        gi_FallbackFont* fallback = &fallbacks.fonts[i];
+        gi_Face* face = gi_OpenFallback(fallback);
+        if (face == NULL) continue;
+
+        if (gi_CoverageHas(&fallback->coverage, codepoint) && stbtt_FindGlyphIndex(&face->info, codepoint) != 0) result = i;
+    }
+
+    fallbacks.resolved[codepoint] = result;
+    return result;
+}
+
+// the font a glyph comes from. face -1 is the font that was asked for, anything else is a fallback
+static const stbtt_fontinfo* gi_FaceInfo(const stbtt_fontinfo* font, int face) {
+    if (face < 0 || face >= (int)fallbacks.fonts.size()) return font;
+    gi_Face* fallback = gi_OpenFallback(&fallbacks.fonts[face]);
+    return fallback != NULL ? &fallback->info : NULL;
+}
+
+// which font a codepoint comes out of: the font itself or the first fallback that has it
+static const stbtt_fontinfo* gi_ResolveCodepoint(const stbtt_fontinfo* font, int codepoint, int* face, int* glyphIndex) {
+    *face = -1;
+    *glyphIndex = stbtt_FindGlyphIndex(font, codepoint);
+
+    // control characters never fall back, neither does anything when the chain is empty
+    if (*glyphIndex == 0 && codepoint >= 32 && (fallbacks.fonts.empty() == false || fallbacks.directories.empty() == false)) {
+        int index = gi_FindFallback(codepoint);
+        const stbtt_fontinfo* fallback = index != -1 ? gi_FaceInfo(font, index) : NULL;
+        if (fallback != NULL) {
+            *face = index;
+            *glyphIndex = stbtt_FindGlyphIndex(fallback, codepoint);
+            return fallback;
+        }
+    }
+
+    return font;
+}
+
+// the cached glyph for a codepoint, wherever it resolves to.
+// scale is the one for the font that was asked for, fallbacks work out their own
+static const gi_Glyph* gi_GetCodepointGlyph(const stbtt_fontinfo* font, int codepoint, float size, float scale, int phase, int* face, int* glyphIndex) {
+    const stbtt_fontinfo* info = gi_ResolveCodepoint(font, codepoint, face, glyphIndex);
+    return gi_GetGlyph(info, *glyphIndex, size, info == font ? scale : stbtt_ScaleForPixelHeight(info, size), phase);
+}
+
+void gsgl_AddFallbackFont(const char* fileName) {
+    gi_FallbackFont fallback = {};
+    fallback.path = fileName;
+    fallbacks.fonts.push_back(fallback);
+
+    // anything that didn't have a font before might have one now
+    for (auto it = fallbacks.resolved.begin(); it != fallbacks.resolved.end();) {
+        if (it->second == -1) it = fallbacks.resolved.erase(it);
+        else it++;
+    }
+}
+void gsgl_AddFallbackDirectory(const char* path) {
+    fallbacks.directories.push_back(path);
+    fallbacks.scanned = false;
+    fallbacks.resolved.clear();
+}
+void gsgl_UnloadFallbackFonts() {
+    // the chain stays as it is, fonts just get opened again if they're needed after this
+    for (gi_FallbackFont& fallback : fallbacks.fonts) {
+        if (fallback.registered == true) gsgl_UnloadFont(fallback.font);
+        fallback.registered = false;
+        fallback.covered = false;
+        fallback.font = gsgl_InvalidFont();
+        fallback.coverage = {};
+    }
+}
+
+// == TEXT MEASUREMENT
+#define GSGL_MEASURE_CACHE_SIZE 256 // strings kept around between frames
+
+typedef struct gi_MeasureKey {
+    const void* font;
+    int size;      // pixel size in 1/64ths
+    uint64_t hash; // of the text
+    int length;
+
+    bool operator==(const gi_MeasureKey& other) const {
+        return font == other.font && size == other.size && hash == other.hash && length == other.length;
+    }
+} gi_MeasureKey;
+
+struct gi_MeasureKeyHash {
+    size_t operator()(const gi_MeasureKey& key) const {
+        size_t hash = std::hash<const void*>()(key.font);
+        hash = hash * 31 + (size_t)key.size;
+        hash = hash * 31 + (size_t)key.hash;
+        return hash;
+    }
+};
+
+typedef struct gi_Measure {
+    std::string text; // to tell hash collisions apart
+    std::vector<int> advances;
+    GSGL_TextMetrics metrics;
+    uint64_t lastUsed;
+} gi_Measure;
+
+static struct {
+    // node based, so pointers into it survive inserting more
+    std::unordered_map<gi_MeasureKey, gi_Measure, gi_MeasureKeyHash> entries;
+    uint64_t frame;
+} measureCache;
+
+static uint64_t gi_HashText(const char* text, int* length) {
+    uint64_t hash = 14695981039346656037ULL;
+    const char* p = text;
+    for (; *p; ++p) {
+        hash ^= (unsigned char)*p;
+        hash *= 1099511628211ULL;
+    }
+    *length = (int)(p - text);
+    return hash;
+}
 
-    for (const char* p = text; *p; ++p) {
-        int codepoint = *p;
-        int advance, lsb;
-        stbtt_GetCodepointHMetrics(&font.font, codepoint, &advance, &lsb);
+static void gi_MeasureCachePurge(const void* font) {
+    for (auto it = measureCache.entries.begin(); it != measureCache.entries.end();) {
+        if (it->first.font == font) it = measureCache.entries.erase(it);
+        else it++;
+    }
+}
 
-        int x0, y0, x1, y1;
-        stbtt_GetCodepointBitmapBox(&font.font, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+// called from gsgl_SwapBuffers, nothing handed out by gsgl_MeasureText is in use anymore after it
+void gi_TextEndFrame() {
+    // whatever got finished in the meantime goes in now, outside of any drawing
+    gi_PublishGlyphs();
 
-        int glyph_width = x1 - x0;
-        int glyph_height = y1 - y0;
+    if (measureCache.entries.size() > GSGL_MEASURE_CACHE_SIZE) {
+        for (auto it = measureCache.entries.begin(); it != measureCache.entries.end();) {
+            if (it->second.lastUsed < measureCache.frame) it = measureCache.entries.erase(it);
+            else it++;
+        }
 
-        if (height == 0) height = glyph_height;
+        // everything was used this frame, nothing to be smart about
+        if (measureCache.entries.size() > GSGL_MEASURE_CACHE_SIZE) measureCache.entries.clear();
+    }
 
-        width += (int)(advance * scale);
+    measureCache.frame++;
+}
+
+const GSGL_TextMetrics* gsgl_MeasureText(GSGL_Font font, const char* text, float font_size) {
+    gi_Face* face = gi_GetFace(font);
+
+    gi_MeasureKey key = {};
+    key.font = face != NULL ? face->data : NULL;
+    key.size = (int)(font_size * 64.0f + 0.5f);
+    key.hash = gi_HashText(text, &key.length);
+
+    gi_Measure* entry = &measureCache.entries[key];
+    entry->lastUsed = measureCache.frame;
+    if (entry->metrics.advances != NULL && entry->text.compare(0, std::string::npos, text, key.length) == 0) {
+        return &entry->metrics;
     }
 
-    return {width, height};
+    entry->text.assign(text, key.length);
+    entry->advances.assign(key.length + 1, 0);
+
+    // same pen gsgl_DrawText moves, each offset is where it rounds to at that point
+    float pen = 0.0f;
+    int height = 0;
+    if (face != NULL) {
+        float scale = stbtt_ScaleForPixelHeight(&face->info, font_size);
+
+        // bytes in the middle of a character get the width up to the character they belong to
+        for (const char* p = text; *p;) {
+            int start = (int)(p - text);
+            int codepoint = gi_DecodeUTF8(&p);
+
+            int phase;
+            gi_SnapPen(pen, &phase);
+
+            int glyphFace, glyphIndex;
+            const gi_Glyph* glyph = gi_GetCodepointGlyph(&face->info, codepoint, font_size, scale, phase, &glyphFace, &glyphIndex);
+            if (height == 0) height = glyph->height;
+
+            for (int i = start + 1; i < (int)(p - text); i++) entry->advances[i] = entry->advances[start];
+            pen += glyph->advance;
+            entry->advances[p - text] = (int)std::floor(pen + 0.5f);
+        }
+    }
+    int width = (int)std::ceil(pen);
+
+    entry->metrics.advances = entry->advances.data();
+    entry->metrics.length = key.length;
+    entry->metrics.width = width;
+    entry->metrics.height = height;
+    return &entry->metrics;
+}
+
+void gsgl_SetGlyphCacheBudget(size_t bytes) {
+    glyphCache.budget = bytes;
+}
+size_t gsgl_GetGlyphCacheSize() {
+    return glyphCache.bytes;
+}
+
+Vector2i gsgl_GetCodepointSize(GSGL_Font font, const char* codepoint, float font_size) {
+    gi_Face* face = gi_GetFace(font);
+    if (face == NULL) return {0, 0};
+
+    float scale = stbtt_ScaleForPixelHeight(&face->info, font_size);
+
+    int glyphFace, glyphIndex;
+    const gi_Glyph* glyph = gi_GetCodepointGlyph(&face->info, gi_DecodeUTF8(&codepoint), font_size, scale, 0, &glyphFace, &glyphIndex);
+    return {glyph->width, glyph->height};
+}
+Vector2i gsgl_GetTextSize(GSGL_Font font, const char* text, float font_size) {
+    const GSGL_TextMetrics* metrics = gsgl_MeasureText(font, text, font_size);
+    return {metrics->width, metrics->height};
+}
+
+int gsgl_GetLineHeight(GSGL_Font font, float font_size) {
+    gi_Face* face = gi_GetFace(font);
+    if (face == NULL) return 0;
+
+    int ascent, descent, line_gap;
+    stbtt_GetFontVMetrics(&face->info, &ascent, &descent, &line_gap);
+    return (int)((ascent - descent + line_gap) * stbtt_ScaleForPixelHeight(&face->info, font_size));
 }
 
 void gsgl_DrawText(GSGL_Font font, const char* text, int x, int y, float font_size, Color col) {
-    if (font.valid == false) return;
+    gi_Face* face = gi_GetFace(font);
+    if (face == NULL) return;
 
-    float scale = stbtt_ScaleForPixelHeight(&font.font, font_size);
+    float scale = stbtt_ScaleForPixelHeight(&face->info, font_size);
 
     int ascent, descent, line_gap;
-    stbtt_GetFontVMetrics(&font.font, &ascent, &descent, &line_gap);
+    stbtt_GetFontVMetrics(&face->info, &ascent, &descent, &line_gap);
     int baseline = y + (int)(ascent * scale);
 
-    int cursor_x = x;
+    float cursor_x = 0.0f; // from x, in fractional pixels
     int cursor_y = baseline;
 
-    for (const char* p = text; *p; ++p) {
-        int codepoint = *p;
-        int advance, lsb;
-        stbtt_GetCodepointHMetrics(&font.font, codepoint, &advance, &lsb);
+    glyphCache.clock++;
+    bool queued = false;
 
-        int x0, y0, x1, y1;
-        stbtt_GetCodepointBitmapBox(&font.font, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+    for (const char* p = text; *p;) {
+        int codepoint = gi_DecodeUTF8(&p);
 
-        int glyph_width = x1 - x0;
-        int glyph_height = y1 - y0;
+        int phase;
+        int pixel = gi_SnapPen(cursor_x, &phase);
 
-        unsigned char* bitmap = stbtt_GetCodepointBitmap(&font.font, 0, scale, codepoint, &glyph_width, &glyph_height, 0, 0);
+        int glyphFace, glyphIndex;
+        const gi_Glyph* glyph = gi_GetCodepointGlyph(&face->info, codepoint, font_size, scale, phase, &glyphFace, &glyphIndex);
 
-        for (int j = 0; j < glyph_height; j++) {
-            for (int i = 0; i < glyph_width; i++) {
-                int fb_x = cursor_x + i + x0;
-                int fb_y = cursor_y + j + y0;
-
-                if (fb_x >= 0 && fb_x < gsgl_GetScreenWidth() && fb_y >= 0 && fb_y < gsgl_GetScreenHeight()) {
-                    uint8_t alpha = bitmap[j * glyph_width + i];
-                    uint32_t color = (alpha << 24) | (col.r << 16) | (col.g << 8) | col.b;
-                    gsgl_BufferAccess(1, fb_y * gsgl_GetScreenWidth() + fb_x, color);
+        if (glyph->pending == true) {
+            // nobody laid this out beforehand, so at least get the rest of it going while waiting on this one
+            if (queued == false) {
+                float rest_x = cursor_x + glyph->advance;
+                for (const char* rest = p; *rest;) {
+                    int restPhase, restFace, restIndex;
+                    gi_SnapPen(rest_x, &restPhase);
+                    rest_x += gi_GetCodepointGlyph(&face->info, gi_DecodeUTF8(&rest), font_size, scale, restPhase, &restFace, &restIndex)->advance;
                 }
+                queued = true;
             }
+
+            const stbtt_fontinfo* info = gi_FaceInfo(&face->info, glyphFace);
+            if (info != NULL) glyph = gi_WaitForGlyph(info, glyphIndex, font_size, glyphFace == -1 ? scale : stbtt_ScaleForPixelHeight(info, font_size), phase);
         }
 
-        cursor_x += (int)(advance * scale);
+        gi_BlitGlyph(glyph, x + pixel, cursor_y, col);
+
+        cursor_x += glyph->advance;
 
         // do newline aswell
         if (codepoint == 10) { // \n
-            cursor_x = x;
+            cursor_x = 0.0f;
             cursor_y += (int)((ascent - descent + line_gap) * scale);
         }
+    }
+}
+
+// == TEXT RUNS
+GSGL_TextRun gsgl_CreateTextRun(GSGL_Font font, const char* text, float font_size) {
+    GSGL_TextRun run = { 0 };
+    run.valid = false;
+    gi_Face* runFace = gi_GetFace(font);
+    if (runFace == NULL) return run;
+
+    run.font = font;
+    run.size = font_size;
+    run.scale = stbtt_ScaleForPixelHeight(&runFace->info, font_size);
+
+    int ascent, descent, line_gap;
+    stbtt_GetFontVMetrics(&runFace->info, &ascent, &descent, &line_gap);
+    int baseline = (int)(ascent * run.scale);
+    int lineHeight = (int)((ascent - descent + line_gap) * run.scale);
+
+    // one glyph per byte at most
+    size_t length = strlen(text);
+    run.glyphs = (GSGL_RunGlyph*)malloc((length + 1) * sizeof(GSGL_RunGlyph));
+    run.breaks = (GSGL_TextBreak*)malloc((length + 1) * sizeof(GSGL_TextBreak));
+
+    float penX = 0.0f;
+    int penY = baseline;
+    int previous = 0;
+    int previousFace = -1;
+    int inkX0 = INT32_MAX, inkY0 = INT32_MAX, inkX1 = INT32_MIN, inkY1 = INT32_MIN;
+    float width = 0.0f;
+    int lines = 1;
+
+    glyphCache.clock++;
+
+    for (const char* p = text; *p;) {
+        int offset = (int)(p - text);
+        int codepoint = gi_DecodeUTF8(&p);
+
+        if (codepoint == '\n') {
+            width = std::max(width, penX);
+            penX = 0.0f;
+            penY += lineHeight;
+            previous = 0;
+            lines++;
+
+            run.breaks[run.breakCount++] = {run.glyphCount, true};
+            continue;
+        }
+
+        int face, glyphIndex;
+        const stbtt_fontinfo* info = gi_ResolveCodepoint(&runFace->info, codepoint, &face, &glyphIndex);
+        float scale = face == -1 ? run.scale : stbtt_ScaleForPixelHeight(info, font_size);
 
-        stbtt_FreeBitmap(bitmap, NULL);
+        // kerning only makes sense between two glyphs of the same font
+        if (previous != 0 && face == previousFace) {
+            penX += stbtt_GetGlyphKernAdvance(info, previous, glyphIndex) * scale;
+        }
+
+        // runs get drawn at whole pixels, so the phase only depends on where the glyph is in the run
+        int phase;
+        int pixel = gi_SnapPen(penX, &phase);
+        const gi_Glyph* glyph = gi_GetGlyph(info, glyphIndex, font_size, scale, phase);
+
+        GSGL_RunGlyph* out = &run.glyphs[run.glyphCount++];
+        out->glyph = glyphIndex;
+        out->face = face;
+        out->offset = offset;
+        out->x = penX;
+        out->y = penY;
+
+        if (glyph->width > 0 && glyph->height > 0) {
+            int gx = pixel + glyph->x0;
+            int gy = penY + glyph->y0;
+            inkX0 = std::min(inkX0, gx);
+            inkY0 = std::min(inkY0, gy);
+            inkX1 = std::max(inkX1, gx + glyph->width);
+            inkY1 = std::max(inkY1, gy + glyph->height);
+        }
+
+        penX += glyph->advance;
+        previous = glyphIndex;
+        previousFace = face;
+
+        // the next line can start after whitespace or a hyphen/slash
+        if (codepoint == ' ' || codepoint == '\t' || codepoint == '-' || codepoint == '/') {
+            run.breaks[run.breakCount++] = {run.glyphCount, false};
+        }
     }
+
+    width = std::max(width, penX);
+    run.width = (int)std::ceil(width);
+    run.height = lines * lineHeight;
+    if (inkX0 <= inkX1) run.bounds = {inkX0, inkY0, inkX1 - inkX0, inkY1 - inkY0};
+
+    run.valid = true;
+    return run;
+}
+void gsgl_UnloadTextRun(GSGL_TextRun run) {
+    free(run.glyphs);
+    free(run.breaks);
 }
 
-bool gsgl_IsFontValid(GSGL_Font font) {
-    return font.valid == true && font.font_buffer != NULL;
+// the same lookups gsgl_DrawTextRun does, minus the waiting. anything missing gets queued
+bool gsgl_IsTextRunReady(const GSGL_TextRun* run) {
+    if (run->valid == false) return true;
+
+    gi_Face* runFace = gi_GetFace(run->font);
+    if (runFace == NULL) return true;
+
+    // whatever got finished since the last look counts
+    gi_PublishGlyphs();
+
+    bool ready = true;
+    for (int i = 0; i < run->glyphCount; i++) {
+        const GSGL_RunGlyph* runGlyph = &run->glyphs[i];
+        const stbtt_fontinfo* info = gi_FaceInfo(&runFace->info, runGlyph->face);
+        if (info == NULL) continue;
+
+        float scale = runGlyph->face == -1 ? run->scale : stbtt_ScaleForPixelHeight(info, run->size);
+        int phase;
+        gi_SnapPen(runGlyph->x, &phase);
+
+        if (gi_GetGlyph(info, runGlyph->glyph, run->size, scale, phase)->pending == true) ready = false;
+    }
+    return ready;
+}
+
+void gsgl_DrawTextRun(const GSGL_TextRun* run, int x, int y, Color col) {
+    if (run->valid == false) return;
+
+    gi_Face* runFace = gi_GetFace(run->font);
+    if (runFace == NULL) return;
+
+    glyphCache.clock++;
+
+    for (int i = 0; i < run->glyphCount; i++) {
+        const GSGL_RunGlyph* runGlyph = &run->glyphs[i];
+        const stbtt_fontinfo* info = gi_FaceInfo(&runFace->info, runGlyph->face);
+        if (info == NULL) continue;
+
+        float scale = runGlyph->face == -1 ? run->scale : stbtt_ScaleForPixelHeight(info, run->size);
+        int phase;
+        int pixel = gi_SnapPen(runGlyph->x, &phase);
+
+        const gi_Glyph* glyph = gi_WaitForGlyph(info, runGlyph->glyph, run->size, scale, phase);
+        gi_BlitGlyph(glyph, x + pixel, y + runGlyph->y, col);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,514 @@
+// Generic Software Graphics Library (GSGL)
+// Designed for software rendering specifically
+// Heavily inspired by raylib
+
+// Tiled rendering
+// Instead of drawing right away, draws get recorded and sorted into 64x64 tiles.
+// On SwapBuffers every tile that got something drawn into it is rasterized, spread out over a few threads.
+
+/*
+
+How it works:
+- gsgl_Rect, gsgl_DrawImage and gsgl_DrawMask (text) still clip against the screen and the scissors like always.
+  What's left gets recorded as a command and added to every tile it touches. Images and masks get copied into an arena,
+  since the caller is free to reuse its pixels right after.
+
+- Glyphs are the exception (gi_TilesMaskKeyed). They come with a key that says what's in them, and get read straight
+  out of the atlas. text.cpp calls gi_TilesDetach before it overwrites or frees an atlas page, which copies whatever
+  is still pointing into it into the arena.
+
+- Each tile only ever draws inside itself, so it works as its own scissors, and it keeps the bounds of what
+  got drawn into it as its damage. No two threads ever touch the same pixel, so there's no locking while rasterizing.
+
+- Workers grab the next tile off an atomic counter, so a tile with a lot of text doesn't hold up the others.
+  The thread calling SwapBuffers works too.
+
+Tiles keep the order things were drawn in, so blending comes out the same as drawing immediately.
+
+Retained mode (gsgl_RetainedRender):
+- Every command gets hashed when it's recorded (images by their pixels, glyphs by their key), and every tile hashes
+  the commands in it together with the clear color. A tile whose hash didn't change since last frame already has the right pixels
+  in the framebuffer, so it doesn't get rasterized at all.
+
+- Since there are 2 or 3 framebuffers, the hash has to stay the same for that many frames in a row before
+  every one of them has caught up. Until then the tile still gets drawn. A frame that isn't drawn this way
+  (not retained, or not tiled at all) starts every tile over.
+
+- Framebuffers don't get lazily cleared in this mode (that would throw the kept pixels away),
+  so a tile that does get drawn clears itself first. That includes tiles that just became empty.
+
+*/
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../logger.h"
+#include "gsgl.h"
+
+#define GSGL_TILE_SIZE 64
+
+typedef enum {
+    GI_TILE_FILL,
+    GI_TILE_IMAGE,
+    GI_TILE_MASK,
+} gi_TileCommandType;
+
+typedef struct gi_TileCommand {
+    gi_TileCommandType type;
+    Recti rect;      // already clipped
+    uint32_t color;  // fill and mask
+    size_t offset;   // image and mask, where the pixels start in their arena. rows are rect.width long
+    uint64_t hash;
+
+    // keyed masks that are still where the caller has them, NULL once they're in the arena
+    const uint8_t* source;
+    int sourceStride;
+} gi_TileCommand;
+
+typedef struct gi_Tile {
+    std::vector<int> commands;
+    Recti damage;
+
+    // retained mode
+    uint64_t hash;
+    int stable; // how many frames in a row the hash stayed the same
+} gi_Tile;
+
+static struct {
+    bool active;
+    bool retained;
+    int threadCount;
+
+    // recorded this frame
+    std::vector<gi_TileCommand> commands;
+    std::vector<uint32_t> arena;
+    std::vector<uint8_t> maskArena;
+
+    std::vector<gi_Tile> tiles;
+    int columns;
+    int rows;
+    int width;
+    int height;
+
+    // tiles that have something in them
+    std::vector<int> busy;
+
+    // tiles that have to be rasterized, the workers go through these
+    std::vector<int> jobs;
+    std::atomic<int> next;
+    uint32_t* buffer;
+    uint32_t clearColor;
+
+    // workers
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned int generation;
+    int working;
+    bool quit;
+} tileCore;
+
+bool gi_TilesActive();
+void gi_TilesStart(int threads);
+void gi_TilesStop();
+void gi_TilesReset();
+void gi_TilesSetRetained(bool retained);
+bool gi_TilesRetained();
+void gi_TilesInvalidate();
+void gi_TilesFill(Recti rect, uint32_t color);
+void gi_TilesImage(Recti rect, const uint32_t* pixels, int stride);
+void gi_TilesMask(Recti rect, const uint8_t* mask, int stride, uint32_t color);
+void gi_TilesMaskKeyed(Recti rect, const uint8_t* mask, int stride, uint32_t color, uint64_t key);
+void gi_TilesDetach();
+void gi_TilesFlush(uint32_t* buffer, uint32_t clearColor, int bufferCount);
+
+void gi_TilesResize();
+void gi_TilesBin(int command);
+uint64_t gi_TilesHash(uint64_t hash, const void* data, size_t size);
+void gi_TilesFindJobs(int bufferCount);
+void gi_TilesRasterize();
+void gi_TilesRasterizeTile(int index);
+void gi_TilesWorker();
+
+// == SETUP
+bool gi_TilesActive() {
+    return tileCore.active;
+}
+
+void gi_TilesStart(int threads) {
+    if (tileCore.active == true) gi_TilesStop();
+
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0) threads = 1; // hardware_concurrency is allowed to not know
+
+    tileCore.threadCount = threads;
+    tileCore.quit = false;
+    tileCore.generation = 0;
+    tileCore.working = 0;
+
+    // the calling thread is one of them
+    for (int i = 0; i < threads - 1; i++) {
+        tileCore.workers.emplace_back(gi_TilesWorker);
+    }
+
+    tileCore.active = true;
+    gi_TilesReset();
+    gi_TilesInvalidate(); // drawn immediately until now
+
+    Logger_log(LOGGER_INFO, "GRAPHICS: - Rasterizing in %dx%d tiles on %d thread(s)", GSGL_TILE_SIZE, GSGL_TILE_SIZE, threads);
+}
+
+void gi_TilesStop() {
+    if (tileCore.active == false) return;
+
+    {
+        std::lock_guard<std::mutex> guard(tileCore.lock);
+        tileCore.quit = true;
+    }
+    tileCore.wake.notify_all();
+
+    for (std::thread& worker : tileCore.workers) worker.join();
+    tileCore.workers.clear();
+
+    tileCore.active = false;
+    gi_TilesReset();
+}
+
+// drops everything recorded so far
+void gi_TilesReset() {
+    for (int index : tileCore.busy) {
+        tileCore.tiles[index].commands.clear();
+    }
+    tileCore.busy.clear();
+    tileCore.jobs.clear();
+    tileCore.commands.clear();
+    tileCore.arena.clear();
+    tileCore.maskArena.clear();
+}
+
+void gi_TilesSetRetained(bool retained) {
+    if (tileCore.retained == retained) return;
+
+    tileCore.retained = retained;
+    gi_TilesInvalidate();
+}
+bool gi_TilesRetained() {
+    return tileCore.active == true && tileCore.retained == true;
+}
+
+// the framebuffers can't be trusted to still have what the tiles think they have
+void gi_TilesInvalidate() {
+    for (gi_Tile& tile : tileCore.tiles) {
+        tile.hash = 0;
+        tile.stable = 0;
+    }
+}
+
+void gi_TilesResize() {
+    int width = gsgl_GetScreenWidth();
+    int height = gsgl_GetScreenHeight();
+    if (width == tileCore.width && height == tileCore.height) return;
+
+    gi_TilesReset();
+
+    tileCore.width = width;
+    tileCore.height = height;
+    tileCore.columns = (width + GSGL_TILE_SIZE - 1) / GSGL_TILE_SIZE;
+    tileCore.rows = (height + GSGL_TILE_SIZE - 1) / GSGL_TILE_SIZE;
+
+    tileCore.tiles.clear();
+    tileCore.tiles.resize(tileCore.columns * tileCore.rows);
+}
+
+// == RECORDING
+// FNV-1a
+uint64_t gi_TilesHash(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+void gi_TilesBin(int command) {
+    Recti rect = tileCore.commands[command].rect;
+
+    int tx0 = rect.x / GSGL_TILE_SIZE;
+    int ty0 = rect.y / GSGL_TILE_SIZE;
+    int tx1 = (rect.x + rect.width - 1) / GSGL_TILE_SIZE;
+    int ty1 = (rect.y + rect.height - 1) / GSGL_TILE_SIZE;
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            int index = ty * tileCore.columns + tx;
+            gi_Tile* tile = &tileCore.tiles[index];
+
+            // the part of it that's inside this tile
+            int x0 = std::max(rect.x, tx * GSGL_TILE_SIZE);
+            int y0 = std::max(rect.y, ty * GSGL_TILE_SIZE);
+            int x1 = std::min(rect.x + rect.width, (tx + 1) * GSGL_TILE_SIZE);
+            int y1 = std::min(rect.y + rect.height, (ty + 1) * GSGL_TILE_SIZE);
+
+            if (tile->commands.empty()) {
+                tileCore.busy.push_back(index);
+                tile->damage = {x0, y0, x1 - x0, y1 - y0};
+            } else {
+                int dx0 = std::min(tile->damage.x, x0);
+                int dy0 = std::min(tile->damage.y, y0);
+                int dx1 = std::max(tile->damage.x + tile->damage.width, x1);
+                int dy1 = std::max(tile->damage.y + tile->damage.height, y1);
+                tile->damage = {dx0, dy0, dx1 - dx0, dy1 - dy0};
+            }
+
+            tile->commands.push_back(command);
+        }
+    }
+}
+
+void gi_TilesFill(Recti rect, uint32_t color) {
+    gi_TilesResize();
+
+    gi_TileCommand command = {GI_TILE_FILL, rect, color, 0, 0, NULL, 0};
+    if (tileCore.retained == true) {
+        command.hash = gi_TilesHash(0xCBF29CE484222325ULL, &command.type, sizeof(command.type));
+        command.hash = gi_TilesHash(command.hash, &rect, sizeof(rect));
+        command.hash = gi_TilesHash(command.hash, &color, sizeof(color));
+    }
+
+    tileCore.commands.push_back(command);
+    gi_TilesBin((int)tileCore.commands.size() - 1);
+}
+
+void gi_TilesImage(Recti rect, const uint32_t* pixels, int stride) {
+    gi_TilesResize();
+
+    gi_TileCommand command = {GI_TILE_IMAGE, rect, 0, tileCore.arena.size(), 0, NULL, 0};
+    if (tileCore.retained == true) {
+        command.hash = gi_TilesHash(0xCBF29CE484222325ULL, &command.type, sizeof(command.type));
+        command.hash = gi_TilesHash(command.hash, &rect, sizeof(rect));
+    }
+
+    for (int j = 0; j < rect.height; j++) {
+        const uint32_t* row = pixels + j * stride;
+        tileCore.arena.insert(tileCore.arena.end(), row, row + rect.width);
+
+        if (tileCore.retained == true) command.hash = gi_TilesHash(command.hash, row, rect.width * sizeof(uint32_t));
+    }
+
+    tileCore.commands.push_back(command);
+    gi_TilesBin((int)tileCore.commands.size() - 1);
+}
+
+void gi_TilesMask(Recti rect, const uint8_t* mask, int stride, uint32_t color) {
+    gi_TilesResize();
+
+    // a quarter of the size of the same thing as an image
+    gi_TileCommand command = {GI_TILE_MASK, rect, color, tileCore.maskArena.size(), 0, NULL, 0};
+    if (tileCore.retained == true) {
+        command.hash = gi_TilesHash(0xCBF29CE484222325ULL, &command.type, sizeof(command.type));
+        command.hash = gi_TilesHash(command.hash, &rect, sizeof(rect));
+        command.hash = gi_TilesHash(command.hash, &color, sizeof(color));
+    }
+
+    for (int j = 0; j < rect.height; j++) {
+        const uint8_t* row = mask + j * stride;
+        tileCore.maskArena.insert(tileCore.maskArena.end(), row, row + rect.width);
+
+        if (tileCore.retained == true) command.hash = gi_TilesHash(command.hash, row, rect.width);
+    }
+
+    tileCore.commands.push_back(command);
+    gi_TilesBin((int)tileCore.commands.size() - 1);
+}
+
+// a mask whose contents are known by key (a glyph), so it never gets hashed and only gets copied if gi_TilesDetach says so.
+// the key has to cover where inside it the clipped rect starts
+void gi_TilesMaskKeyed(Recti rect, const uint8_t* mask, int stride, uint32_t color, uint64_t key) {
+    gi_TilesResize();
+
+    gi_TileCommand command = {GI_TILE_MASK, rect, color, 0, 0, mask, stride};
+    if (tileCore.retained == true) {
+        command.hash = gi_TilesHash(0xCBF29CE484222325ULL, &command.type, sizeof(command.type));
+        command.hash = gi_TilesHash(command.hash, &rect, sizeof(rect));
+        command.hash = gi_TilesHash(command.hash, &color, sizeof(color));
+        command.hash = gi_TilesHash(command.hash, &key, sizeof(key));
+    }
+
+    tileCore.commands.push_back(command);
+    gi_TilesBin((int)tileCore.commands.size() - 1);
+}
+
+// copies every keyed mask recorded so far into the arena, their pixels are about to change
+void gi_TilesDetach() {
+    for (gi_TileCommand& command : tileCore.commands) {
+        if (command.source == NULL) continue;
+
+        command.offset = tileCore.maskArena.size();
+        for (int j = 0; j < command.rect.height; j++) {
+            const uint8_t* row = command.source + j * command.sourceStride;
+            tileCore.maskArena.insert(tileCore.maskArena.end(), row, row + command.rect.width);
+        }
+        command.source = NULL;
+    }
+}
+
+// == RASTERIZING
+void gi_TilesRasterizeTile(int index) {
+    gi_Tile* tile = &tileCore.tiles[index];
+
+    int tx = (index % tileCore.columns) * GSGL_TILE_SIZE;
+    int ty = (index / tileCore.columns) * GSGL_TILE_SIZE;
+    int tileX1 = std::min(tx + GSGL_TILE_SIZE, tileCore.width);
+    int tileY1 = std::min(ty + GSGL_TILE_SIZE, tileCore.height);
+
+    // nothing cleared it, it still has whatever was drawn in it a few frames ago
+    if (tileCore.retained == true) {
+        for (int j = ty; j < tileY1; j++) {
+            uint32_t* row = tileCore.buffer + j * tileCore.width + tx;
+            std::fill(row, row + (tileX1 - tx), tileCore.clearColor);
+        }
+        tile->damage = {tx, ty, tileX1 - tx, tileY1 - ty};
+    }
+
+    for (int c : tile->commands) {
+        const gi_TileCommand* command = &tileCore.commands[c];
+        Recti rect = command->rect;
+
+        int x0 = std::max(rect.x, tx);
+        int y0 = std::max(rect.y, ty);
+        int x1 = std::min(rect.x + rect.width, tileX1);
+        int y1 = std::min(rect.y + rect.height, tileY1);
+        int count = x1 - x0;
+
+        for (int j = y0; j < y1; j++) {
+            uint32_t* row = tileCore.buffer + j * tileCore.width + x0;
+
+            if (command->type == GI_TILE_FILL) {
+                if ((command->color >> 24) == 255) {
+                    std::fill(row, row + count, command->color);
+                } else {
+                    gsgl_BlendSpanColor(row, command->color, count);
+                }
+            } else if (command->type == GI_TILE_MASK) {
+                const uint8_t* mask;
+                if (command->source != NULL) mask = command->source + (j - rect.y) * command->sourceStride + (x0 - rect.x);
+                else mask = tileCore.maskArena.data() + command->offset + (j - rect.y) * rect.width + (x0 - rect.x);
+                gsgl_BlendMaskSpan(row, mask, command->color, count);
+            } else {
+                const uint32_t* src = tileCore.arena.data() + command->offset + (j - rect.y) * rect.width + (x0 - rect.x);
+                gsgl_BlendSpan(row, src, count);
+            }
+        }
+    }
+}
+
+void gi_TilesRasterize() {
+    int total = (int)tileCore.jobs.size();
+    while (true) {
+        int i = tileCore.next.fetch_add(1, std::memory_order_relaxed);
+        if (i >= total) break;
+
+        gi_TilesRasterizeTile(tileCore.jobs[i]);
+    }
+}
+
+void gi_TilesFindJobs(int bufferCount) {
+    tileCore.jobs.clear();
+
+    if (tileCore.retained == false) {
+        // whatever the framebuffers had in them, it's not what the hashes say anymore
+        gi_TilesInvalidate();
+        tileCore.jobs = tileCore.busy;
+        return;
+    }
+
+    // every tile, empty ones might still need clearing
+    for (int i = 0; i < (int)tileCore.tiles.size(); i++) {
+        gi_Tile* tile = &tileCore.tiles[i];
+
+        uint64_t hash = gi_TilesHash(0xCBF29CE484222325ULL, &tileCore.clearColor, sizeof(tileCore.clearColor));
+        for (int c : tile->commands) {
+            hash = gi_TilesHash(hash, &tileCore.commands[c].hash, sizeof(uint64_t));
+        }
+
+        if (hash == tile->hash) {
+            tile->stable++;
+        } else {
+            tile->hash = hash;
+            tile->stable = 0;
+        }
+
+        // every framebuffer has it already
+        if (tile->stable >= bufferCount) continue;
+        tileCore.jobs.push_back(i);
+    }
+}
+
+void gi_TilesWorker() {
+    unsigned int seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(tileCore.lock);
+            tileCore.wake.wait(guard, [&] { return tileCore.quit == true || tileCore.generation != seen; });
+            if (tileCore.quit == true) return;
+            seen = tileCore.generation;
+        }
+
+        gi_TilesRasterize();
+
+        {
+            std::lock_guard<std::mutex> guard(tileCore.lock);
+            tileCore.working--;
+        }
+        tileCore.done.notify_one();
+    }
+}
+
+// draws everything recorded this frame into the buffer
+void gi_TilesFlush(uint32_t* buffer, uint32_t clearColor, int bufferCount) {
+    if (tileCore.active == false) return;
+    gi_TilesResize();
+
+    tileCore.buffer = buffer;
+    tileCore.clearColor = clearColor;
+    gi_TilesFindJobs(bufferCount);
+
+    if (tileCore.jobs.empty()) {
+        gi_TilesReset();
+        return;
+    }
+    tileCore.next.store(0, std::memory_order_relaxed);
+
+    // not worth waking anyone up for a single tile
+    bool spread = tileCore.workers.empty() == false && tileCore.jobs.size() > 1;
+    if (spread == true) {
+        {
+            std::lock_guard<std::mutex> guard(tileCore.lock);
+            tileCore.generation++;
+            tileCore.working = (int)tileCore.workers.size();
+        }
+        tileCore.wake.notify_all();
+    }
+
+    gi_TilesRasterize();
+
+    if (spread == true) {
+        std::unique_lock<std::mutex> guard(tileCore.lock);
+        tileCore.done.wait(guard, [] { return tileCore.working == 0; });
+    }
+
+    for (int index : tileCore.jobs) {
+        Recti damage = tileCore.tiles[index].damage;
+        gsgl_DamageRect(damage.x, damage.y, damage.width, damage.height);
+    }
+
+    gi_TilesReset();
+}
\ No newline at end of file
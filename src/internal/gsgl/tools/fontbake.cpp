@@ -0,0 +1,176 @@
+// Generic Software Graphics Library (GSGL)
+// Designed for software rendering specifically
+// Heavily inspired by raylib
+
+// This is the glyph baker, it runs at build time (see CMakeLists.txt)
+
+/*
+
+- Rasterizes printable ASCII of a font at a few pixel sizes, at every subpixel phase, and packs it all into one A8 atlas.
+  The result is a header with a GSGL_BakedAtlas in it, for gsgl_AddBakedGlyphs.
+- It goes through stb_truetype exactly like text.cpp does, so a baked glyph is bit for bit the one that would've been rasterized.
+  If how text.cpp works out metrics or phases changes, this has to change with it.
+
+usage: fontbake <font.ttf> <output.h> <name> <size> [size...]
+
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "../libs/stb_truetype.h"
+
+#define BAKE_PHASES 4        // GSGL_GLYPH_PHASES
+#define BAKE_ATLAS_WIDTH 256
+#define BAKE_FIRST_CHAR 32
+#define BAKE_LAST_CHAR 126
+
+typedef struct BakedGlyph {
+    int glyph;
+    int size;
+    int phase;
+    float advance;
+    int x0;
+    int y0;
+    int width;
+    int height;
+    int atlasX;
+    int atlasY;
+    std::vector<unsigned char> bitmap;
+} BakedGlyph;
+
+static std::vector<unsigned char> ReadFile(const char* path) {
+    std::vector<unsigned char> data;
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return data;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    data.resize(size > 0 ? (size_t)size : 0);
+    if (data.empty() == false && fread(data.data(), 1, data.size(), file) != data.size()) data.clear();
+    fclose(file);
+
+    return data;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 5) {
+        fprintf(stderr, "usage: fontbake <font.ttf> <output.h> <name> <size> [size...]\n");
+        return 1;
+    }
+
+    std::vector<unsigned char> data = ReadFile(argv[1]);
+    stbtt_fontinfo font;
+    if (data.empty() == true || !stbtt_InitFont(&font, data.data(), stbtt_GetFontOffsetForIndex(data.data(), 0))) {
+        fprintf(stderr, "fontbake: couldn't load font '%s'\n", argv[1]);
+        return 1;
+    }
+    const char* name = argv[3];
+
+    std::vector<BakedGlyph> glyphs;
+    for (int arg = 4; arg < argc; arg++) {
+        float size = (float)atof(argv[arg]);
+        float scale = stbtt_ScaleForPixelHeight(&font, size);
+
+        // a few characters might share a glyph (the missing one, mostly)
+        std::set<int> seen;
+        for (int codepoint = BAKE_FIRST_CHAR; codepoint <= BAKE_LAST_CHAR; codepoint++) {
+            int glyph = stbtt_FindGlyphIndex(&font, codepoint);
+            if (seen.insert(glyph).second == false) continue;
+
+            for (int phase = 0; phase < BAKE_PHASES; phase++) {
+                BakedGlyph baked = {};
+                baked.glyph = glyph;
+                baked.size = (int)(size * 64.0f + 0.5f);
+                baked.phase = phase;
+
+                int advance, lsb;
+                stbtt_GetGlyphHMetrics(&font, glyph, &advance, &lsb);
+                baked.advance = advance * scale;
+
+                int x0, y0, x1, y1;
+                stbtt_GetGlyphBitmapBoxSubpixel(&font, glyph, scale, scale, phase / (float)BAKE_PHASES, 0, &x0, &y0, &x1, &y1);
+                baked.x0 = x0;
+                baked.y0 = y0;
+                baked.width = x1 - x0;
+                baked.height = y1 - y0;
+
+                if (baked.width > 0 && baked.height > 0) {
+                    baked.bitmap.resize((size_t)baked.width * baked.height);
+                    stbtt_MakeGlyphBitmapSubpixel(&font, baked.bitmap.data(), baked.width, baked.height, baked.width, scale, scale, phase / (float)BAKE_PHASES, 0, glyph);
+                }
+
+                glyphs.push_back(baked);
+            }
+        }
+    }
+
+    // shelf packing, tallest first so the shelves don't waste much
+    std::vector<BakedGlyph*> order;
+    for (BakedGlyph& glyph : glyphs) order.push_back(&glyph);
+    std::stable_sort(order.begin(), order.end(), [](const BakedGlyph* a, const BakedGlyph* b) { return a->height > b->height; });
+
+    int shelfX = 0, shelfY = 0, shelfHeight = 0;
+    for (BakedGlyph* glyph : order) {
+        if (glyph->bitmap.empty() == true) continue;
+
+        if (shelfX + glyph->width > BAKE_ATLAS_WIDTH) {
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+        }
+        glyph->atlasX = shelfX;
+        glyph->atlasY = shelfY;
+        shelfX += glyph->width;
+        shelfHeight = std::max(shelfHeight, glyph->height);
+    }
+    int atlasHeight = std::max(shelfY + shelfHeight, 1);
+
+    std::vector<unsigned char> atlas((size_t)BAKE_ATLAS_WIDTH * atlasHeight, 0);
+    for (const BakedGlyph& glyph : glyphs) {
+        for (int j = 0; j < glyph.height; j++) {
+            memcpy(&atlas[(size_t)(glyph.atlasY + j) * BAKE_ATLAS_WIDTH + glyph.atlasX], &glyph.bitmap[(size_t)j * glyph.width], glyph.width);
+        }
+    }
+
+    FILE* out = fopen(argv[2], "wb");
+    if (out == NULL) {
+        fprintf(stderr, "fontbake: couldn't write '%s'\n", argv[2]);
+        return 1;
+    }
+
+    const char* fileName = std::max(strrchr(argv[1], '/'), strrchr(argv[1], '\\'));
+    fprintf(out, "// generated by fontbake from %s, don't edit\n", fileName != NULL ? fileName + 1 : argv[1]);
+    fprintf(out, "// needs gsgl.h included first\n\n#pragma once\n\n");
+
+    fprintf(out, "static constexpr uint8_t %sBakedPixels[%d * %d] = {", name, BAKE_ATLAS_WIDTH, atlasHeight);
+    for (size_t i = 0; i < atlas.size(); i++) {
+        if (i % 32 == 0) fprintf(out, "\n    ");
+        fprintf(out, "%d,", atlas[i]);
+    }
+    fprintf(out, "\n};\n\n");
+
+    // advances as hex floats, so they come out exactly like text.cpp would've worked them out
+    fprintf(out, "static constexpr GSGL_BakedGlyph %sBakedGlyphs[%d] = {\n", name, (int)glyphs.size());
+    for (const BakedGlyph& glyph : glyphs) {
+        fprintf(out, "    {%d, %d, %d, %a, %d, %d, %d, %d, %d, %d},\n", glyph.glyph, glyph.size, glyph.phase, glyph.advance,
+            glyph.x0, glyph.y0, glyph.width, glyph.height, glyph.atlasX, glyph.atlasY);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static constexpr GSGL_BakedAtlas %sBaked = {%sBakedPixels, %d, %d, %sBakedGlyphs, %d};", name, name, BAKE_ATLAS_WIDTH, atlasHeight, name, (int)glyphs.size());
+    fclose(out);
+
+    printf("fontbake: %d glyphs from %s in a %dx%d atlas\n", (int)glyphs.size(), argv[1], BAKE_ATLAS_WIDTH, atlasHeight);
+    return 0;
+}
\ No newline at end of file
@@ -7,6 +7,7 @@
     - We have a Renderer class that handles the window
     - We have a Networker class that handles networking
     - We have a Scripter class that handles code
+    - On Linux, a Reactor sleeps until any of them has something to do
 
 */
 
@@ -14,15 +15,47 @@
 #include "classes/main/renderer.h"
 #include "classes/main/networker.h"
 #include "classes/main/scripter.h"
+#include "classes/main/reactor.h"
+#include "classes/main/profiler.h"
 
 #include "logger.h"
 
+#include <algorithm>
+#include <charconv>
+#include <string>
+
 Handler* handler;
 Renderer* renderer;
 Networker* networker;
 Scripter* scripter;
+Profiler* profiler;
+#ifndef _WIN32
+Reactor* reactor;
+#endif
+
+void runFrame() {
+    profiler->begin(PROFILE_FRAME);
+
+    // Update
+    networker->update();
+
+    profiler->begin(PROFILE_UPDATE);
+    handler->update();
+    profiler->end(PROFILE_UPDATE);
+
+    renderer->update();
+    scripter->update();
+
+    //----------------------------------------------------------------------------------
 
-int main() {
+    // Draw
+    renderer->draw();
+    //----------------------------------------------------------------------------------
+
+    profiler->end(PROFILE_FRAME);
+}
+
+int main(int argc, char* argv[]) {
     // Initialization
     Logger_init();
 
@@ -39,11 +72,38 @@ int main() {
     Logger_log(LOGGER_INFO, "----------------------------------------------------------------------------------");
 
     // initialize handlers
+    #ifndef _WIN32
+    reactor = new Reactor();
+    reactor->init();
+    #endif
+
+    profiler = new Profiler();
     networker = new Networker();
     handler = new Handler();
     renderer = new Renderer();
     scripter = new Scripter();
 
+    // command line
+    //  --headless      no window, for benchmarks and pixel checks
+    //  --frames=N      close after N frames
+    //  --dump=FILE     save the last frame as a ppm
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--headless") renderer->headless = true;
+        else if (arg.rfind("--frames=", 0) == 0) {
+            // anything that isn't a whole, non-negative number gets ignored instead of taking the whole thing down
+            int frames = 0;
+            const char* first = arg.c_str() + 9;
+            const char* last = arg.c_str() + arg.size();
+            auto parsed = std::from_chars(first, last, frames);
+            if (parsed.ec != std::errc() || parsed.ptr != last || frames < 0) Logger_log(LOGGER_WARNING, "Invalid frame count %s, ignoring it", first);
+            else renderer->frameLimit = frames;
+        }
+        else if (arg.rfind("--dump=", 0) == 0) renderer->dumpPath = arg.substr(7);
+        else Logger_log(LOGGER_WARNING, "Unknown argument %s", arg.c_str());
+    }
+
     networker->init();
     renderer->init();
     handler->init();
@@ -53,26 +113,51 @@ int main() {
 
     //----------------------------------------------------------------------------------
 
-    while (!renderer->shouldClose()) {
-        // Update
-        networker->update();
-        handler->update();
-        renderer->update();
-        scripter->update();
+    #ifndef _WIN32
+    // headless runs flat out for benchmarking, everything else only wakes up when there's something to do
+    if (renderer->headless == false) {
+        // the X connection. events get read by gsgl_DrainEvents below, this just wakes the loop up
+        reactor->watch(gsgl_GetEventFd(), EPOLLIN, [](uint32_t) {});
+
+        // curl's sockets and timers too, so transfers move along while nothing else happens
+        networker->attach(reactor);
+
+        double nextFrame = 0;
+        while (!renderer->shouldClose()) {
+            // Wait
+            double timeout = -1; // nothing to do, sleep until something happens
+            if (gsgl_HasPendingEvents()) timeout = 0;
+            else if (renderer->isDirty()) timeout = std::max(nextFrame - Reactor::now(), 0.0);
+
+            reactor->run(timeout);
+            if (gsgl_DrainEvents()) renderer->invalidate();
+
+            // don't go over the frame rate, even if things keep changing
+            if (renderer->isDirty() == false || Reactor::now() < nextFrame) continue;
+            nextFrame = Reactor::now() + 1.0 / renderer->frameRate;
 
-        //----------------------------------------------------------------------------------
+            runFrame();
+        }
+    }
+    #endif
 
-        // Draw
-        renderer->draw();
-        //----------------------------------------------------------------------------------
+    while (!renderer->shouldClose()) {
+        runFrame();
     }
 
     Logger_log(LOGGER_INFO, "----------------------------------------------------------------------------------");
     Logger_log(LOGGER_INFO, "Application closing");
 
+    profiler->dump("profile.json");
+
     // De-Initialization
     //--------------------------------------------------------------------------------------
     renderer->close();
+    networker->close();
+
+    #ifndef _WIN32
+    reactor->close();
+    #endif
     //--------------------------------------------------------------------------------------
 
     Logger_log(LOGGER_INFO, "----------------------------------------------------------------------------------");
@@ -4,8 +4,14 @@
 #include "classes/main/renderer.h"
 #include "classes/main/networker.h"
 #include "classes/main/scripter.h"
+#include "classes/main/reactor.h"
+#include "classes/main/profiler.h"
 
 extern Handler* handler;
 extern Renderer* renderer;
 extern Networker* networker;
-extern Scripter* scripter;
\ No newline at end of file
+extern Scripter* scripter;
+extern Profiler* profiler;
+#ifndef _WIN32
+extern Reactor* reactor;
+#endif
\ No newline at end of file